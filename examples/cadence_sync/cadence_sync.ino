@@ -0,0 +1,74 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include "PetKitApi.h"
+#include "WhiskerApi.h"
+
+// Both providers refresh pets/devices daily, status every minute and history
+// hourly. Intervals are aligned to the wall clock, so the two come due at
+// the same moments: the radio is switched on once per window and the board
+// light-sleeps in between. Only the requests that are due are sent.
+
+const char *ssid = "your-ssid-here";
+const char *password = "your-password-here";
+
+const char *petkit_username = "your-username-here";
+const char *petkit_password = "your-petkit-login-here";
+const char *petkit_region = "us";
+const char *petkit_timezone = "America/Los_Angeles";
+const char *whisker_email = "your-email-here";
+const char *whisker_password = "your-whisker-login-here";
+const char *tzInfo = "PST8PDT,M3.2.0,M11.1.0";
+
+PetKitApi petkit(petkit_username, petkit_password, petkit_region, petkit_timezone);
+WhiskerApi whisker(whisker_email, whisker_password, petkit_timezone);
+
+void configure(SmartLitterbox &box) {
+  box.cadence().setInterval(SL_DataClass::PETS, 24 * 3600);
+  box.cadence().setInterval(SL_DataClass::STATUS, 60);
+  box.cadence().setInterval(SL_DataClass::RECORDS, 3600);
+}
+
+void radioOn() {
+  WiFi.mode(WIFI_STA);
+  WiFi.begin(ssid, password);
+  while (WiFi.status() != WL_CONNECTED) delay(100);
+}
+
+void radioOff() {
+  WiFi.disconnect(true);
+  WiFi.mode(WIFI_OFF);
+}
+
+void setup() {
+  Serial.begin(115200);
+  radioOn();
+  configTzTime(tzInfo, "pool.ntp.org");
+  while (time(nullptr) < 1000000) delay(100);
+
+  configure(petkit);
+  configure(whisker);
+
+  // A drawer emptied by hand: pick up status and history on the next window
+  whisker.onEvent([](const SL_Event &e) {
+    if (e.type == SL_EventType::DRAWER_EMPTIED) whisker.invalidate(SL_DataClass::RECORDS);
+  });
+}
+
+void loop() {
+  if (WiFi.status() != WL_CONNECTED) radioOn();
+
+  uint32_t start = millis();
+  petkit.fetchAllData(7);
+  whisker.fetchAllData(20);
+  Serial.printf("Window took %u ms\n", (unsigned)(millis() - start));
+  radioOff();
+
+  time_t now = time(nullptr);
+  time_t wake = min(petkit.cadence().nextDue(now), whisker.cadence().nextDue(now));
+  if (wake > now) {
+    Serial.printf("Sleeping %ld s\n", (long)(wake - now));
+    Serial.flush();
+    esp_sleep_enable_timer_wakeup((uint64_t)(wake - now) * 1000000ULL);
+    esp_light_sleep_start();
+  }
+}
@@ -0,0 +1,73 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include "PetKitApi.h"
+#include "RecordWriter.h"
+
+// --- WiFi and Petkit Credentials ---
+const char *ssid = "your-ssid-here";
+const char *password = "your-password-here";
+
+const char *petkit_username = "your-username-here";
+const char *petkit_password = "your-petkit-login-here";
+const char *petkit_region = "us";
+const char *petkit_timezone = "America/Los_Angeles";
+const char *tzInfo = "PST8PDT,M3.2.0,M11.1.0";
+
+PetKitApi petkit(petkit_username, petkit_password, petkit_region, petkit_timezone);
+
+// Discards output but counts bytes, for timing the formatter alone
+class NullPrint : public Print {
+public:
+  size_t count = 0;
+  size_t write(uint8_t) override { count++; return 1; }
+  size_t write(const uint8_t *, size_t size) override { count += size; return size; }
+};
+
+void benchmark(SL_ExportFormat format, const char *label) {
+  NullPrint sink;
+  RecordWriter writer(sink, format);
+  SL_RecordView r = {"Luna, the cat", 123456, 1700000000, 9.81f, 42.0f, "Visit", "t4"};
+
+  uint32_t heap_before = ESP.getFreeHeap();
+  uint32_t start = micros();
+  for (int i = 0; i < 10000; i++) {
+    r.timestamp++;
+    writer.write(r);
+  }
+  writer.flush();
+  uint32_t elapsed = micros() - start;
+
+  Serial.printf("%s: 10000 records, %u bytes in %u us (%.1f rec/ms), heap delta %d\n",
+    label, (unsigned)sink.count, (unsigned)elapsed, 10000000.0f / elapsed,
+    (int)heap_before - (int)ESP.getFreeHeap());
+}
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("\nRecord Export Example");
+
+  benchmark(SL_ExportFormat::CSV, "CSV");
+  benchmark(SL_ExportFormat::INFLUX, "Influx");
+
+  WiFi.begin(ssid, password);
+  while (WiFi.status() != WL_CONNECTED) delay(500);
+
+  configTzTime(tzInfo, "pool.ntp.org");
+  while (time(nullptr) < 1000000) delay(100);
+
+  if (petkit.fetchAllData(7)) {
+    // Swap Serial for an SD File to log to card
+    RecordWriter csv(Serial, SL_ExportFormat::CSV);
+    csv.writeRecordHeader();
+    csv.writeAll(petkit);
+
+    RecordWriter influx(Serial, SL_ExportFormat::INFLUX);
+    influx.write(petkit.getUnifiedStatus());
+    influx.flush();
+  } else {
+    Serial.println("Failed to fetch data.");
+  }
+}
+
+void loop() {
+}
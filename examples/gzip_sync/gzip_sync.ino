@@ -0,0 +1,47 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include "PetKitApi.h"
+#include "Esp32HttpTransport.h"
+
+// Runs the same sync with and without Accept-Encoding: gzip and prints bytes
+// on the wire and end-to-end time for each. Compressed bodies are inflated
+// straight into the JSON parser, so heap use stays flat in both modes.
+
+const char *ssid = "your-ssid-here";
+const char *password = "your-password-here";
+
+const char *petkit_username = "your-username-here";
+const char *petkit_password = "your-petkit-login-here";
+const char *petkit_region = "us";
+const char *petkit_timezone = "America/Los_Angeles";
+const char *tzInfo = "PST8PDT,M3.2.0,M11.1.0";
+
+PetKitApi petkit(petkit_username, petkit_password, petkit_region, petkit_timezone);
+Esp32HttpTransport transport;
+
+void runSync(bool gzip) {
+  transport.setAcceptGzip(gzip);
+  transport.resetStats();
+
+  uint32_t start = millis();
+  bool ok = petkit.fetchAllData(7);
+  Serial.printf("%s: sync %s in %u ms, min free heap %u\n", gzip ? "gzip" : "identity",
+    ok ? "ok" : "failed", (unsigned)(millis() - start), (unsigned)ESP.getMinFreeHeap());
+  transport.printStats(Serial);
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  WiFi.begin(ssid, password);
+  while (WiFi.status() != WL_CONNECTED) delay(100);
+  configTzTime(tzInfo, "pool.ntp.org");
+  while (time(nullptr) < 1000000) delay(100);
+
+  petkit.setTransport(transport);
+  runSync(false);
+  runSync(true);
+}
+
+void loop() {
+}
@@ -0,0 +1,63 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include "PetKitApi.h"
+#include "WhiskerApi.h"
+#include "Esp32HttpTransport.h"
+#include "ThreadedHttpEngine.h"
+
+// Keeps several requests in flight during a sync. PetKit's day requests and
+// Whisker's per-pet / per-robot queries are independent, so with an
+// asynchronous transport their round trips overlap instead of adding up.
+// Even loops run with one request at a time for comparison.
+
+const char *ssid = "your-ssid-here";
+const char *password = "your-password-here";
+
+const char *petkit_username = "your-username-here";
+const char *petkit_password = "your-petkit-login-here";
+const char *petkit_region = "us";
+const char *petkit_timezone = "America/Los_Angeles";
+const char *whisker_email = "your-email-here";
+const char *whisker_password = "your-whisker-login-here";
+const char *tzInfo = "PST8PDT,M3.2.0,M11.1.0";
+
+#define WORKERS 3   // Concurrent TLS connections; each worker needs ~40 KB of heap
+
+PetKitApi petkit(petkit_username, petkit_password, petkit_region, petkit_timezone);
+WhiskerApi whisker(whisker_email, whisker_password, petkit_timezone);
+Esp32HttpTransport transport;
+ThreadedHttpEngine *engine;
+int loop_count = 0;
+
+void setup() {
+  Serial.begin(115200);
+  WiFi.begin(ssid, password);
+  while (WiFi.status() != WL_CONNECTED) delay(100);
+  configTzTime(tzInfo, "pool.ntp.org");
+  while (time(nullptr) < 1000000) delay(100);
+
+  engine = new ThreadedHttpEngine(transport, WORKERS);
+}
+
+void loop() {
+  bool parallel = (loop_count++ % 2) == 0;
+  HttpTransport &t = parallel ? (HttpTransport &)*engine : (HttpTransport &)transport;
+  petkit.setTransport(t);
+  whisker.setTransport(t);
+  petkit.setMaxInFlight(WORKERS);
+  whisker.setMaxInFlight(WORKERS);
+  petkit.invalidate();
+  whisker.invalidate();
+
+  uint32_t start = millis();
+  petkit.fetchAllData(7);
+  uint32_t petkit_ms = millis() - start;
+  start = millis();
+  whisker.fetchAllData(20);
+  uint32_t whisker_ms = millis() - start;
+
+  Serial.printf("%s: PetKit %u ms, Whisker %u ms, free heap %u\n",
+    parallel ? "parallel" : "sequential", (unsigned)petkit_ms, (unsigned)whisker_ms,
+    (unsigned)ESP.getFreeHeap());
+  delay(60000);
+}
@@ -0,0 +1,70 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <SD.h>
+#include "PetKitApi.h"
+#include "Esp32HttpTransport.h"
+#include "ReplayTransport.h"
+
+// First boot with RECORD set captures a full sync to the SD card. Afterwards,
+// clear RECORD and the same sync is served from the card with shaped latency,
+// so fetchAllData() can be timed without the cloud (or WiFi).
+#define RECORD 1
+
+const char *ssid = "your-ssid-here";
+const char *password = "your-password-here";
+
+const char *petkit_username = "your-username-here";
+const char *petkit_password = "your-petkit-login-here";
+const char *petkit_region = "us";
+const char *petkit_timezone = "America/Los_Angeles";
+const char *tzInfo = "PST8PDT,M3.2.0,M11.1.0";
+
+const char *journal = "/sd/petkit_sync.jrnl";
+
+PetKitApi petkit(petkit_username, petkit_password, petkit_region, petkit_timezone);
+Esp32HttpTransport wifi_transport;
+RecordingTransport recorder(wifi_transport, journal);
+ReplayTransport replayer(journal);
+
+void setup() {
+  Serial.begin(115200);
+  if (!SD.begin()) {
+    Serial.println("SD mount failed.");
+    return;
+  }
+
+#if RECORD
+  WiFi.begin(ssid, password);
+  while (WiFi.status() != WL_CONNECTED) delay(500);
+  configTzTime(tzInfo, "pool.ntp.org");
+  while (time(nullptr) < 1000000) delay(100);
+
+  recorder.begin();
+  petkit.setTransport(recorder);
+#else
+  // Replayed signatures don't matter, but login() still insists on a sane clock
+  struct timeval tv = {1700000000, 0};
+  settimeofday(&tv, nullptr);
+
+  replayer.begin();
+  replayer.setLatency(180, 60);       // Typical cloud RTT
+  replayer.setBandwidth(40000);       // Weak WiFi link
+  replayer.setFailureRate(0.05, 503); // Exercise the backoff path
+  petkit.setTransport(replayer);
+#endif
+
+  uint32_t start = millis();
+  bool ok = petkit.fetchAllData(30);
+  Serial.printf("fetchAllData: %s in %u ms, %u records\n",
+    ok ? "ok" : "failed", (unsigned)(millis() - start),
+    (unsigned)petkit.getLitterboxRecords().size());
+
+#if RECORD
+  recorder.end();
+#else
+  Serial.printf("Replay misses: %lu\n", replayer.missCount());
+#endif
+}
+
+void loop() {
+}
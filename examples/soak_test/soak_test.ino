@@ -0,0 +1,119 @@
+#include <Arduino.h>
+#include <algorithm>
+#include "PetKitApi.h"
+#include "WhiskerApi.h"
+#include "StubCloudTransport.h"
+#include "esp_heap_caps.h"
+
+// Soak / scale test against an in-process stub cloud, no WiFi needed.
+// Both providers sync a synthetic household over and over while the clock is
+// pushed forward, so new visits keep arriving. Every round prints sync time,
+// heap low-water mark, fragmentation and request latency percentiles.
+
+// Household under test
+#define DEVICES 5
+#define CATS 8
+#define DAYS 365
+#define VISITS_PER_DAY 4.5
+
+#define PETKIT_DAYS 30      // fetchAllData(days_back)
+#define WHISKER_LIMIT 50    // fetchAllData(limit)
+#define ROUNDS 0            // 0 = run forever
+#define CLOCK_STEP_S 3600   // Simulated time between rounds
+
+const char *tzInfo = "PST8PDT,M3.2.0,M11.1.0";
+
+// Wraps a transport and keeps the latency of the most recent requests
+class TimingTransport : public HttpTransport {
+public:
+  TimingTransport(HttpTransport &inner) : _inner(inner), _count(0) {}
+
+  int send(const HttpRequest &req, HttpResponse &resp) override {
+    uint32_t start = millis();
+    int status = _inner.send(req, resp);
+    _samples[_count++ % SAMPLES] = millis() - start;
+    return status;
+  }
+
+  // p in [0, 100] over the retained samples
+  uint32_t percentile(float p) {
+    size_t n = std::min(_count, (size_t)SAMPLES);
+    if (n == 0) return 0;
+    std::copy(_samples, _samples + n, _scratch);
+    size_t k = std::min(n - 1, (size_t)(p / 100.0f * n));
+    std::nth_element(_scratch, _scratch + k, _scratch + n);
+    return _scratch[k];
+  }
+
+  void reset() { _count = 0; }
+
+private:
+  static const size_t SAMPLES = 512;
+  HttpTransport &_inner;
+  uint32_t _samples[SAMPLES];
+  uint32_t _scratch[SAMPLES];
+  size_t _count;
+};
+
+StubCloudTransport stub;
+TimingTransport timing(stub);
+PetKitApi petkit("soak@example.com", "soak", "us", "America/Los_Angeles");
+WhiskerApi whisker("soak@example.com", "soak", "America/Los_Angeles");
+
+uint32_t round_no = 0;
+
+void printHeap() {
+  size_t free_bytes = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  unsigned frag = free_bytes ? 100 - (unsigned)(largest * 100 / free_bytes) : 0;
+  Serial.printf("  heap: free %u, min %u, largest block %u, fragmentation %u%%\n",
+    (unsigned)free_bytes, (unsigned)ESP.getMinFreeHeap(), (unsigned)largest, frag);
+}
+
+void runSync(SmartLitterbox &box, const char *name, int param) {
+  timing.reset();
+  uint32_t start = millis();
+  bool ok = box.fetchAllData(param);
+  uint32_t elapsed = millis() - start;
+
+  Serial.printf("  %-7s %s in %u ms, %u records, latency p50 %u / p90 %u / p99 %u / max %u ms\n",
+    name, ok ? "ok" : "FAILED", (unsigned)elapsed, (unsigned)box.recordCount(),
+    (unsigned)timing.percentile(50), (unsigned)timing.percentile(90),
+    (unsigned)timing.percentile(99), (unsigned)timing.percentile(100));
+}
+
+void setup() {
+  Serial.begin(115200);
+  setenv("TZ", tzInfo, 1);
+  tzset();
+  struct timeval tv = {1700000000, 0};
+  settimeofday(&tv, nullptr);
+
+  stub.setHousehold({DEVICES, CATS, DAYS, VISITS_PER_DAY});
+  stub.setLatency(120, 80);
+
+  petkit.setTransport(timing);
+  whisker.setTransport(timing);
+
+  Serial.printf("Household: %d devices, %d cats, %d days, %.1f visits/cat/day\n",
+    DEVICES, CATS, DAYS, VISITS_PER_DAY);
+  printHeap();
+}
+
+void loop() {
+  if (ROUNDS && round_no >= ROUNDS) {
+    delay(1000);
+    return;
+  }
+  round_no++;
+  Serial.printf("Round %u (%lu stub requests so far)\n", (unsigned)round_no, stub.requestCount());
+
+  runSync(petkit, "PetKit", PETKIT_DAYS);
+  runSync(whisker, "Whisker", WHISKER_LIMIT);
+  printHeap();
+  if (stub.unknownCount()) Serial.printf("  %lu requests hit no stub endpoint\n", stub.unknownCount());
+
+  // Let simulated time pass so the next round has new events to pick up
+  struct timeval tv = {time(nullptr) + CLOCK_STEP_S, 0};
+  settimeofday(&tv, nullptr);
+}
@@ -0,0 +1,43 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include "PetKitApi.h"
+
+// Forwards each new visit as it is parsed instead of reading the record
+// vectors afterwards. With storage off, memory use does not depend on how
+// many days are fetched. Swap the prints for an MQTT publish.
+
+const char *ssid = "your-ssid-here";
+const char *password = "your-password-here";
+
+const char *petkit_username = "your-username-here";
+const char *petkit_password = "your-petkit-login-here";
+const char *petkit_region = "us";
+const char *petkit_timezone = "America/Los_Angeles";
+const char *tzInfo = "PST8PDT,M3.2.0,M11.1.0";
+
+PetKitApi petkit(petkit_username, petkit_password, petkit_region, petkit_timezone);
+
+void setup() {
+  Serial.begin(115200);
+
+  WiFi.begin(ssid, password);
+  while (WiFi.status() != WL_CONNECTED) delay(100);
+  configTzTime(tzInfo, "pool.ntp.org");
+  while (time(nullptr) < 1000000) delay(100);
+
+  petkit.setStoreRecords(false);
+  petkit.onRecord([](const SL_RecordView &r) {
+    Serial.printf("visit: %s %.2f lbs %.0f s at %ld (%s)\n", r.pet_name, r.weight_lbs,
+      r.duration_seconds, (long)r.timestamp, r.source_device);
+  });
+  petkit.onStatus([](const SL_Status &s) {
+    Serial.printf("status: %s litter %d%%\n", s.device_name.c_str(), s.litter_level_percent);
+  });
+}
+
+void loop() {
+  // Only visits newer than the last poll are delivered
+  petkit.fetchAllData(7);
+  Serial.printf("free heap %u\n", (unsigned)ESP.getFreeHeap());
+  delay(5 * 60 * 1000);
+}
@@ -0,0 +1,58 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include "PetKitApi.h"
+#include "Esp32HttpTransport.h"
+
+// Syncs, then deep-sleeps. TLS sessions are kept in RTC memory, so even the
+// first request after waking resumes instead of doing a full handshake.
+// Even boots run without resumption for comparison.
+
+const char *ssid = "your-ssid-here";
+const char *password = "your-password-here";
+
+const char *petkit_username = "your-username-here";
+const char *petkit_password = "your-petkit-login-here";
+const char *petkit_region = "us";
+const char *petkit_timezone = "America/Los_Angeles";
+const char *tzInfo = "PST8PDT,M3.2.0,M11.1.0";
+
+#define SLEEP_SECONDS 60
+
+RTC_DATA_ATTR int boot_count = 0;
+RTC_DATA_ATTR uint8_t tls_state[3072];
+RTC_DATA_ATTR size_t tls_state_len = 0;
+
+PetKitApi petkit(petkit_username, petkit_password, petkit_region, petkit_timezone);
+TlsSessionCache &tls_cache = TlsSessionCache::shared();
+Esp32HttpTransport transport;
+
+void setup() {
+  Serial.begin(115200);
+  boot_count++;
+  bool resume = (boot_count % 2) == 1;
+
+  WiFi.begin(ssid, password);
+  while (WiFi.status() != WL_CONNECTED) delay(100);
+  configTzTime(tzInfo, "pool.ntp.org");
+  while (time(nullptr) < 1000000) delay(100);
+
+  if (resume && tls_state_len) tls_cache.restore(tls_state, tls_state_len);
+  transport.setTlsSessionCache(resume ? &tls_cache : nullptr);
+  petkit.setTransport(transport);
+
+  uint32_t start = millis();
+  bool ok = petkit.fetchAllData(1);
+  Serial.printf("Boot %d (%s): sync %s in %u ms\n", boot_count,
+    resume ? "resumption" : "full handshakes", ok ? "ok" : "failed",
+    (unsigned)(millis() - start));
+
+  if (resume) {
+    tls_cache.printStats(Serial);
+    tls_state_len = tls_cache.save(tls_state, sizeof(tls_state));
+  }
+
+  esp_deep_sleep(SLEEP_SECONDS * 1000000ULL);
+}
+
+void loop() {
+}
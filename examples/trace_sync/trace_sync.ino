@@ -0,0 +1,41 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include "PetKitApi.h"
+#include "TraceBuffer.h"
+
+// Records where one sync spends its time (DNS + connect, TLS, server wait,
+// body download, JSON parsing, pacing) and prints it as a Chrome trace.
+// Copy the JSON between the markers into a file and open it in
+// chrome://tracing or https://ui.perfetto.dev.
+// Build with -DSL_TRACE_ENABLED=0 to compile every trace point out.
+
+const char *ssid = "your-ssid-here";
+const char *password = "your-password-here";
+
+const char *petkit_username = "your-username-here";
+const char *petkit_password = "your-petkit-login-here";
+const char *petkit_region = "us";
+const char *petkit_timezone = "America/Los_Angeles";
+const char *tzInfo = "PST8PDT,M3.2.0,M11.1.0";
+
+PetKitApi petkit(petkit_username, petkit_password, petkit_region, petkit_timezone);
+
+void setup() {
+  Serial.begin(115200);
+  WiFi.begin(ssid, password);
+  while (WiFi.status() != WL_CONNECTED) delay(100);
+  configTzTime(tzInfo, "pool.ntp.org");
+  while (time(nullptr) < 1000000) delay(100);
+
+  TraceBuffer::shared().setEnabled(true);
+}
+
+void loop() {
+  TraceBuffer::shared().clear();
+  petkit.fetchAllData(7);
+
+  Serial.println("--- trace begin ---");
+  TraceBuffer::shared().exportChrome(Serial);
+  Serial.println("--- trace end ---");
+  delay(300000);
+}
@@ -0,0 +1,132 @@
+#include "CurlExchange.h"
+#include "InflateStream.h"
+#include "TraceBuffer.h"
+
+static size_t onBody(char* ptr, size_t size, size_t nmemb, void* userdata)
+{
+    CurlExchange* ex = (CurlExchange*)userdata;
+    ex->body.append(ptr, size * nmemb);
+    return size * nmemb;
+}
+
+static size_t onHeader(char* buffer, size_t size, size_t nitems, void* userdata)
+{
+    CurlExchange* ex = (CurlExchange*)userdata;
+    size_t len = size * nitems;
+    String line(buffer, len);
+    int colon = line.indexOf(':');
+    if (colon > 0)
+    {
+        String name = line.substring(0, colon);
+        String value = line.substring(colon + 1);
+        value.trim();
+        if (name.equalsIgnoreCase("Retry-After")) ex->retry_after = value;
+        else if (name.equalsIgnoreCase("Content-Encoding")) ex->content_encoding = value;
+    }
+    return len;
+}
+
+void CurlExchange::prepare(CURL* curl, const HttpRequest& req, bool accept_gzip, bool verify_peer)
+{
+    for (int i = 0; i < req.header_count; i++)
+    {
+        String line = String(req.headers[i].name) + ": " + req.headers[i].value;
+        headers = curl_slist_append(headers, line.c_str());
+    }
+    // Set by hand rather than via CURLOPT_ACCEPT_ENCODING so curl leaves the
+    // body compressed and InflateStream does the decoding
+    if (req.body_handler && accept_gzip) headers = curl_slist_append(headers, "Accept-Encoding: gzip");
+
+    start_us = micros();
+    curl_easy_setopt(curl, CURLOPT_URL, req.url.c_str());
+    // A stall timeout, as HTTPClient's on ESP32: a large body may take longer
+    // than timeout_ms in total as long as it keeps arriving
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, (long)((req.timeout_ms + 999) / 1000));
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS,
+                     (long)(req.connect_timeout_ms ? req.connect_timeout_ms : req.timeout_ms));
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, verify_peer ? 1L : 0L);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, onBody);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, this);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, onHeader);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, this);
+    if (req.isPost())
+    {
+        curl_easy_setopt(curl, CURLOPT_POST, 1L);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, req.body ? (const char*)req.body : "");
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)req.body_length);
+    }
+}
+
+void CurlExchange::finish(CURL* curl, CURLcode rc, const HttpRequest& req, HttpResponse& resp)
+{
+    resp.reset();
+    trace(curl, req);
+    if (rc != CURLE_OK)
+    {
+        resp.status = -(int)rc;
+        resp.error = curl_easy_strerror(rc);
+        return;
+    }
+
+    long code = 0;
+    curl_off_t first_byte = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &first_byte);
+    resp.status = (int)code;
+    resp.retry_after = retry_after;
+    resp.header_ms = (long)(first_byte / 1000);
+
+    if (req.body_handler && resp.status >= 200 && resp.status < 300)
+    {
+        bool gzip = content_encoding.indexOf("gzip") >= 0;
+        MemoryStream raw(body.data(), body.size());
+        InflateStream decoded(raw, gzip, nullptr, (long)body.size());
+        req.body_handler(decoded);
+        resp.wire_bytes = decoded.wireBytes();
+        resp.body_bytes = decoded.inflatedBytes();
+        if (decoded.failed())
+        {
+            resp.status = -(int)CURLE_BAD_CONTENT_ENCODING;
+            resp.error = "gzip decode failed";
+        }
+    }
+    else
+    {
+        resp.body = String(body.data(), body.size());
+        resp.wire_bytes = resp.body_bytes = body.size();
+    }
+}
+
+void CurlExchange::trace(CURL* curl, const HttpRequest& req)
+{
+#if SL_TRACE_ENABLED
+    if (!TraceBuffer::shared().enabled()) return;
+
+    // Offsets from the start of the transfer, in microseconds
+    curl_off_t dns = 0, tcp = 0, tls = 0, sent = 0, first_byte = 0, total = 0;
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &dns);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &tcp);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &tls);
+    curl_easy_getinfo(curl, CURLINFO_PRETRANSFER_TIME_T, &sent);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &first_byte);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
+
+    // One lane per easy handle: transfers on a handle never overlap
+    uint32_t lane = (uint32_t)(uintptr_t)curl;
+    const char* url = req.url.c_str();
+    TraceBuffer& tb = TraceBuffer::shared();
+    tb.record("transfer", "net", start_us, (uint32_t)total, url, lane);
+    // A reused connection shows no DNS / connect / TLS time
+    if (dns > 0) tb.record("dns", "net", start_us, (uint32_t)dns, nullptr, lane);
+    if (tcp > dns) tb.record("tcp connect", "net", start_us + (uint32_t)dns, (uint32_t)(tcp - dns), nullptr, lane);
+    if (tls > tcp) tb.record("tls handshake", "net", start_us + (uint32_t)tcp, (uint32_t)(tls - tcp), nullptr, lane);
+    if (first_byte > sent) tb.record("server wait", "net", start_us + (uint32_t)sent, (uint32_t)(first_byte - sent), nullptr, lane);
+    if (total > first_byte) tb.record("download", "net", start_us + (uint32_t)first_byte, (uint32_t)(total - first_byte), nullptr, lane);
+#else
+    (void)curl;
+    (void)req;
+#endif
+}
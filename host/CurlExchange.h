@@ -0,0 +1,27 @@
+#ifndef CurlExchange_h
+#define CurlExchange_h
+
+#include "HttpTransport.h"
+#include <curl/curl.h>
+#include <string>
+
+// Pieces shared by CurlHttpTransport (easy API) and CurlMultiEngine (multi API)
+
+struct CurlExchange {
+    std::string body;
+    String retry_after;
+    String content_encoding;
+    struct curl_slist* headers = nullptr;
+    uint32_t start_us = 0;
+
+    ~CurlExchange() { if (headers) curl_slist_free_all(headers); }
+
+    // Set URL, method, headers and callbacks on an easy handle for req
+    void prepare(CURL* curl, const HttpRequest& req, bool accept_gzip, bool verify_peer);
+    // Fill resp once the transfer ended with rc; runs req.body_handler on 2xx
+    void finish(CURL* curl, CURLcode rc, const HttpRequest& req, HttpResponse& resp);
+    // Phase spans (DNS, connect, TLS, server wait, download) from curl's timers
+    void trace(CURL* curl, const HttpRequest& req);
+};
+
+#endif
@@ -0,0 +1,129 @@
+#include "CurlHttpTransport.h"
+#include "CurlExchange.h"
+#include <mutex>
+
+HttpTransport& defaultHttpTransport()
+{
+    static CurlHttpTransport instance;
+    return instance;
+}
+
+namespace {
+
+// One mutex per curl_lock_data slot, shared by every transport instance
+std::mutex share_locks[CURL_LOCK_DATA_LAST];
+
+void lockShare(CURL*, curl_lock_data data, curl_lock_access, void*)
+{
+    share_locks[data].lock();
+}
+
+void unlockShare(CURL*, curl_lock_data data, void*)
+{
+    share_locks[data].unlock();
+}
+
+// Per-thread handle: keeps the connection cache warm across requests
+struct ThreadHandle {
+    CURL* curl = nullptr;
+    void* share = nullptr;
+    ~ThreadHandle() { if (curl) curl_easy_cleanup(curl); }
+};
+
+CURL* threadHandle(void* share)
+{
+    thread_local ThreadHandle handle;
+    if (!handle.curl || handle.share != share)
+    {
+        if (handle.curl) curl_easy_cleanup(handle.curl);
+        handle.curl = curl_easy_init();
+        handle.share = share;
+    }
+    else
+    {
+        curl_easy_reset(handle.curl);
+    }
+    return handle.curl;
+}
+
+} // namespace
+
+CurlHttpTransport::CurlHttpTransport()
+    : _share(nullptr),
+      _accept_gzip(true),
+      _verify_peer(true),
+      _requests(0),
+      _wire_bytes(0),
+      _body_bytes(0),
+      _total_ms(0)
+{
+    static std::once_flag global_init;
+    std::call_once(global_init, [] { curl_global_init(CURL_GLOBAL_DEFAULT); });
+
+    CURLSH* share = curl_share_init();
+    if (share)
+    {
+        curl_share_setopt(share, CURLSHOPT_LOCKFUNC, lockShare);
+        curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, unlockShare);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    }
+    _share = share;
+}
+
+CurlHttpTransport::~CurlHttpTransport()
+{
+    if (_share) curl_share_cleanup((CURLSH*)_share);
+}
+
+int CurlHttpTransport::send(const HttpRequest& req, HttpResponse& resp)
+{
+    resp.reset();
+    uint32_t start = millis();
+
+    CURL* curl = threadHandle(_share);
+    if (!curl)
+    {
+        resp.status = -1;
+        resp.error = "curl_easy_init() failed";
+        return resp.status;
+    }
+
+    CurlExchange ex;
+    ex.prepare(curl, req, _accept_gzip, _verify_peer);
+    if (_share) curl_easy_setopt(curl, CURLOPT_SHARE, (CURLSH*)_share);
+
+    CURLcode rc = curl_easy_perform(curl);
+    ex.finish(curl, rc, req, resp);
+
+    _requests++;
+    _wire_bytes += resp.wire_bytes;
+    _body_bytes += resp.body_bytes;
+    _total_ms += millis() - start;
+    return resp.status;
+}
+
+CurlHttpTransport::Stats CurlHttpTransport::stats() const
+{
+    return Stats{_requests.load(), _wire_bytes.load(), _body_bytes.load(), _total_ms.load()};
+}
+
+void CurlHttpTransport::resetStats()
+{
+    _requests = 0;
+    _wire_bytes = 0;
+    _body_bytes = 0;
+    _total_ms = 0;
+}
+
+void CurlHttpTransport::printStats(Print& out) const
+{
+    Stats s = stats();
+    uint32_t saved = s.body_bytes > s.wire_bytes ? s.body_bytes - s.wire_bytes : 0;
+    char line[128];
+    snprintf(line, sizeof(line), "HTTP: %lu requests, %lu bytes on the wire, %lu decoded (%lu saved), avg %lu ms",
+             (unsigned long)s.requests, (unsigned long)s.wire_bytes,
+             (unsigned long)s.body_bytes, (unsigned long)saved,
+             s.requests ? (unsigned long)(s.total_ms / s.requests) : 0UL);
+    out.println(line);
+}
@@ -0,0 +1,45 @@
+#ifndef CurlHttpTransport_h
+#define CurlHttpTransport_h
+
+#include "HttpTransport.h"
+#include <atomic>
+
+// Host transport backed by libcurl. Each thread keeps its own easy handle so
+// connections are reused between requests to the same cloud; DNS results and
+// TLS sessions are shared between threads, the host counterpart of
+// TlsSessionCache. Safe to use from several sync workers at once.
+// Requests with a body_handler ask for gzip; the compressed body is buffered
+// and decoded through InflateStream, as on the ESP32.
+class CurlHttpTransport : public HttpTransport {
+public:
+    struct Stats {
+        uint32_t requests;
+        uint32_t wire_bytes;
+        uint32_t body_bytes;
+        uint32_t total_ms;
+    };
+
+    CurlHttpTransport();
+    ~CurlHttpTransport();
+
+    void setAcceptGzip(bool enabled) { _accept_gzip = enabled; }
+    void setVerifyPeer(bool enabled) { _verify_peer = enabled; }
+
+    int send(const HttpRequest& req, HttpResponse& resp) override;
+
+    Stats stats() const;
+    void resetStats();
+    void printStats(Print& out) const;
+
+private:
+    void* _share;  // CURLSH*
+    bool _accept_gzip;
+    bool _verify_peer;
+
+    std::atomic<uint32_t> _requests;
+    std::atomic<uint32_t> _wire_bytes;
+    std::atomic<uint32_t> _body_bytes;
+    std::atomic<uint32_t> _total_ms;
+};
+
+#endif
@@ -0,0 +1,284 @@
+#include "CurlMultiEngine.h"
+#include "CurlExchange.h"
+#include <condition_variable>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+struct CurlMultiEngine::Transfer {
+    CURL* easy;
+    HttpRequest req;
+    HttpCompletion done;
+    CurlExchange ex;
+};
+
+static long long monotonicMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+CurlMultiEngine::CurlMultiEngine(long max_per_host, long max_total)
+    : _deadline_ms(-1),
+      _accept_gzip(true),
+      _verify_peer(true),
+      _closed(false),
+      _in_flight(0),
+      _requests(0),
+      _wire_bytes(0),
+      _body_bytes(0),
+      _peak_in_flight(0)
+{
+    static std::once_flag global_init;
+    std::call_once(global_init, [] { curl_global_init(CURL_GLOBAL_DEFAULT); });
+
+    CURLM* multi = curl_multi_init();
+    curl_multi_setopt(multi, CURLMOPT_SOCKETFUNCTION, _onSocket);
+    curl_multi_setopt(multi, CURLMOPT_SOCKETDATA, this);
+    curl_multi_setopt(multi, CURLMOPT_TIMERFUNCTION, _onTimer);
+    curl_multi_setopt(multi, CURLMOPT_TIMERDATA, this);
+    curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, max_per_host);
+    curl_multi_setopt(multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, max_total);
+    curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, max_total);
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    _multi = multi;
+
+    _epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    _wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = _wake_fd;
+    epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _wake_fd, &ev);
+
+    _thread = std::thread([this] { _loop(); });
+}
+
+CurlMultiEngine::~CurlMultiEngine()
+{
+    _closed = true;
+    uint64_t one = 1;
+    (void)!write(_wake_fd, &one, sizeof(one));
+    _thread.join();
+
+    for (void* easy : _idle_handles) curl_easy_cleanup((CURL*)easy);
+    curl_multi_cleanup((CURLM*)_multi);
+    close(_wake_fd);
+    close(_epoll_fd);
+}
+
+void CurlMultiEngine::submit(const HttpRequest& req, HttpCompletion done)
+{
+    Transfer* t = new Transfer();
+    t->easy = nullptr;
+    t->req = req;
+    t->done = std::move(done);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _pending.push_back(t);
+    }
+    uint64_t one = 1;
+    (void)!write(_wake_fd, &one, sizeof(one));
+}
+
+int CurlMultiEngine::send(const HttpRequest& req, HttpResponse& resp)
+{
+    std::mutex m;
+    std::condition_variable cv;
+    bool finished = false;
+
+    submit(req, [&](HttpResponse& r) {
+        std::lock_guard<std::mutex> lock(m);
+        resp = r;
+        finished = true;
+        cv.notify_one();
+    });
+
+    std::unique_lock<std::mutex> lock(m);
+    cv.wait(lock, [&] { return finished; });
+    return resp.status;
+}
+
+CurlMultiEngine::Stats CurlMultiEngine::stats() const
+{
+    return Stats{_requests.load(), _wire_bytes.load(), _body_bytes.load(), _peak_in_flight.load()};
+}
+
+void CurlMultiEngine::printStats(Print& out) const
+{
+    Stats s = stats();
+    char line[128];
+    snprintf(line, sizeof(line), "HTTP: %lu requests, %lu bytes on the wire, %lu decoded, peak %lu in flight",
+             (unsigned long)s.requests, (unsigned long)s.wire_bytes,
+             (unsigned long)s.body_bytes, (unsigned long)s.peak_in_flight);
+    out.println(line);
+}
+
+// --- Private Helper Methods ---
+
+void CurlMultiEngine::_loop()
+{
+    CURLM* multi = (CURLM*)_multi;
+    struct epoll_event events[64];
+    int running = 0;
+
+    while (!_closed)
+    {
+        int wait_ms = -1;
+        if (_deadline_ms >= 0)
+        {
+            long long left = _deadline_ms - monotonicMs();
+            wait_ms = left > 0 ? (int)left : 0;
+        }
+        int n = epoll_wait(_epoll_fd, events, 64, wait_ms);
+        if (n < 0) n = 0; // EINTR
+        for (int i = 0; i < n; i++)
+        {
+            int fd = events[i].data.fd;
+            if (fd == _wake_fd)
+            {
+                uint64_t count;
+                while (read(_wake_fd, &count, sizeof(count)) > 0) {}
+
+                std::deque<Transfer*> batch;
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    batch.swap(_pending);
+                }
+                for (Transfer* t : batch) _start(t);
+                continue;
+            }
+            int flags = 0;
+            if (events[i].events & EPOLLIN) flags |= CURL_CSELECT_IN;
+            if (events[i].events & EPOLLOUT) flags |= CURL_CSELECT_OUT;
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) flags |= CURL_CSELECT_ERR;
+            curl_multi_socket_action(multi, fd, flags, &running);
+        }
+
+        // Due timers run even while sockets stay busy; that is where curl
+        // cuts off a stalled transfer
+        if (_deadline_ms >= 0 && monotonicMs() >= _deadline_ms)
+        {
+            _deadline_ms = -1; // The action may set a new one
+            curl_multi_socket_action(multi, CURL_SOCKET_TIMEOUT, 0, &running);
+        }
+        _drainFinished();
+    }
+
+    _failAll();
+}
+
+void CurlMultiEngine::_start(Transfer* t)
+{
+    if (!_idle_handles.empty())
+    {
+        t->easy = (CURL*)_idle_handles.back();
+        _idle_handles.pop_back();
+        curl_easy_reset(t->easy);
+    }
+    else
+    {
+        t->easy = curl_easy_init();
+    }
+
+    t->ex.prepare(t->easy, t->req, _accept_gzip, _verify_peer);
+    curl_easy_setopt(t->easy, CURLOPT_PRIVATE, t);
+    curl_multi_add_handle((CURLM*)_multi, t->easy);
+    _active.insert(t);
+
+    _in_flight++;
+    if (_in_flight > _peak_in_flight) _peak_in_flight = _in_flight;
+}
+
+void CurlMultiEngine::_drainFinished()
+{
+    CURLM* multi = (CURLM*)_multi;
+    int queued;
+    while (CURLMsg* msg = curl_multi_info_read(multi, &queued))
+    {
+        if (msg->msg != CURLMSG_DONE) continue;
+
+        CURL* easy = msg->easy_handle;
+        CURLcode rc = msg->data.result;
+        Transfer* t = nullptr;
+        curl_easy_getinfo(easy, CURLINFO_PRIVATE, (char**)&t);
+        curl_multi_remove_handle(multi, easy);
+        _active.erase(t);
+
+        HttpResponse resp;
+        t->ex.finish(easy, rc, t->req, resp);
+        _requests++;
+        _wire_bytes += resp.wire_bytes;
+        _body_bytes += resp.body_bytes;
+        _in_flight--;
+
+        t->done(resp);
+        _idle_handles.push_back(easy);
+        delete t;
+    }
+}
+
+// Shutdown: fail whatever is still queued or in flight, so no send() waits forever
+void CurlMultiEngine::_failAll()
+{
+    CURLM* multi = (CURLM*)_multi;
+    std::deque<Transfer*> left;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        left.swap(_pending);
+    }
+    for (Transfer* t : _active)
+    {
+        curl_multi_remove_handle(multi, t->easy);
+        _idle_handles.push_back(t->easy);
+        _in_flight--;
+        left.push_back(t);
+    }
+    _active.clear();
+
+    for (Transfer* t : left)
+    {
+        HttpResponse resp;
+        resp.status = -(int)CURLE_ABORTED_BY_CALLBACK;
+        resp.error = "engine stopped";
+        t->done(resp);
+        delete t;
+    }
+    int queued;
+    while (CURLMsg* msg = curl_multi_info_read(multi, &queued)) { (void)msg; }
+}
+
+int CurlMultiEngine::_onSocket(void* easy, int fd, int what, void* engine, void* socketp)
+{
+    (void)easy;
+    CurlMultiEngine* self = (CurlMultiEngine*)engine;
+    if (what == CURL_POLL_REMOVE)
+    {
+        epoll_ctl(self->_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        return 0;
+    }
+
+    struct epoll_event ev = {};
+    ev.data.fd = fd;
+    if (what & CURL_POLL_IN) ev.events |= EPOLLIN;
+    if (what & CURL_POLL_OUT) ev.events |= EPOLLOUT;
+
+    if (socketp)
+    {
+        epoll_ctl(self->_epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+    }
+    else
+    {
+        epoll_ctl(self->_epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+        curl_multi_assign((CURLM*)self->_multi, fd, self);
+    }
+    return 0;
+}
+
+int CurlMultiEngine::_onTimer(void* multi, long timeout_ms, void* engine)
+{
+    (void)multi;
+    ((CurlMultiEngine*)engine)->_deadline_ms = timeout_ms < 0 ? -1 : monotonicMs() + timeout_ms;
+    return 0;
+}
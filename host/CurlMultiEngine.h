@@ -0,0 +1,74 @@
+#ifndef CurlMultiEngine_h
+#define CurlMultiEngine_h
+
+#include "HttpTransport.h"
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// Event-loop HTTP engine for the gateway: one thread runs an epoll loop over
+// libcurl's multi interface, so hundreds of requests from any number of
+// accounts are in flight at once without a thread each. Connections are
+// pooled per host (HTTP/1.1 keep-alive, or multiplexed over HTTP/2 where the
+// cloud offers it), capped by max_per_host; requests over the cap wait in
+// curl's queue.
+//
+// submit() is thread-safe. Completions and body handlers run on the loop
+// thread and must not block on the engine. send() submits and waits.
+class CurlMultiEngine : public HttpTransport {
+public:
+    struct Stats {
+        uint32_t requests;
+        uint32_t wire_bytes;
+        uint32_t body_bytes;
+        uint32_t peak_in_flight;
+    };
+
+    CurlMultiEngine(long max_per_host = 8, long max_total = 256);
+    ~CurlMultiEngine();
+
+    void setAcceptGzip(bool enabled) { _accept_gzip = enabled; }
+    void setVerifyPeer(bool enabled) { _verify_peer = enabled; }
+
+    int send(const HttpRequest& req, HttpResponse& resp) override;
+    void submit(const HttpRequest& req, HttpCompletion done) override;
+
+    Stats stats() const;
+    void printStats(Print& out) const;
+
+private:
+    struct Transfer;
+
+    void _loop();
+    void _start(Transfer* t);
+    void _drainFinished();
+    void _failAll();
+
+    static int _onSocket(void* easy, int fd, int what, void* engine, void* socketp);
+    static int _onTimer(void* multi, long timeout_ms, void* engine);
+
+    void* _multi;  // CURLM*
+    int _epoll_fd;
+    int _wake_fd;
+    long long _deadline_ms;  // CLOCK_MONOTONIC ms at which curl's timer fires; -1: none
+    bool _accept_gzip;
+    bool _verify_peer;
+
+    std::mutex _mutex;
+    std::deque<Transfer*> _pending;
+    std::vector<void*> _idle_handles;  // Finished easy handles, reused
+    std::unordered_set<Transfer*> _active;  // Added to the multi handle (loop thread only)
+    std::atomic<bool> _closed;
+    std::thread _thread;
+
+    uint32_t _in_flight;
+    std::atomic<uint32_t> _requests;
+    std::atomic<uint32_t> _wire_bytes;
+    std::atomic<uint32_t> _body_bytes;
+    std::atomic<uint32_t> _peak_in_flight;
+};
+
+#endif
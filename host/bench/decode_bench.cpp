@@ -0,0 +1,206 @@
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "JsonSchema.h"
+
+// Per-record decode cost of the provider parsers' two ways of reading a
+// record: one obj["key"] lookup per field (each a scan of the object's
+// members with string compares) against one SL_Fields pass over the members.
+//
+//   decode_bench [--records N] [--rounds N]
+//
+// The records carry the keys the cloud sends and the parsers ignore, since
+// those are what a member scan walks past. Both loops build the same records.
+
+namespace {
+
+struct Decoded {
+    long timestamp;
+    int pet_id;
+    String pet_name;
+    int weight;
+    long duration;
+    int litter_percent;
+    bool box_full;
+    String event;
+};
+
+void buildPetKitDay(JsonDocument& doc, int records) {
+    JsonArray result = doc["result"].to<JsonArray>();
+    for (int i = 0; i < records; i++) {
+        JsonObject r = result.add<JsonObject>();
+        r["id"] = String("rec-") + String(i);
+        r["deviceId"] = 400123;
+        r["eventType"] = 10;
+        r["aiImage"] = "https://example.invalid/img.jpg";
+        r["petAvatar"] = "https://example.invalid/pet.jpg";
+        r["isNeedUploadVideo"] = 0;
+        r["enumEventType"] = 10;
+        r["timestamp"] = 1700000000L + i * 3600;
+        r["petId"] = 1000 + i % 3;
+        r["petName"] = String("Cat ") + String(i % 3);
+        JsonObject content = r["content"].to<JsonObject>();
+        content["area"] = 1;
+        content["autoClear"] = 1;
+        content["mark"] = 0;
+        content["startReason"] = 0;
+        content["petWeight"] = 4500 + i % 200;
+        content["timeIn"] = 1700000000L + i * 3600;
+        content["timeOut"] = 1700000000L + i * 3600 + 95;
+        content["result"] = 0;
+        JsonObject sub = r["subContent"].add<JsonObject>();
+        sub["eventType"] = 5;
+        JsonObject level = sub["content"].to<JsonObject>();
+        level["boxFull"] = false;
+        level["sandLack"] = false;
+        level["liquidLack"] = false;
+        level["litterPercent"] = 80 - i % 50;
+        level["workTime"] = 120;
+    }
+}
+
+void buildActivity(JsonDocument& doc, int records) {
+    static const char* values[] = {"catWeight", "robotCycleStatusIdle", "robotCycleStatusDump", "DFIFullFlagOn", "catDetect"};
+    JsonArray result = doc["data"]["getLitterRobot4Activity"].to<JsonArray>();
+    for (int i = 0; i < records; i++) {
+        JsonObject a = result.add<JsonObject>();
+        a["timestamp"] = "2024-05-01 12:00:00";
+        a["value"] = values[i % 5];
+        a["actionValue"] = "";
+    }
+}
+
+// As the parsers did it: a lookup per field
+void petKitByLookup(JsonArray records, std::vector<Decoded>& out) {
+    for (JsonObject record : records) {
+        if (!record["enumEventType"]) continue;
+        if (!record["petId"] || !record["content"]) continue;
+        Decoded d;
+        d.timestamp = record["timestamp"].as<long>();
+        d.pet_id = record["petId"].as<int>();
+        d.pet_name = record["petName"].as<String>();
+        d.weight = record["content"]["petWeight"].as<int>();
+        d.duration = record["content"]["timeOut"].as<long>() - record["content"]["timeIn"].as<long>();
+        JsonArray sub = record["subContent"];
+        d.litter_percent = sub[0]["content"]["litterPercent"].as<int>();
+        d.box_full = sub[0]["content"]["boxFull"].as<bool>();
+        out.push_back(d);
+    }
+}
+
+enum { REC_EVENT_TYPE, REC_TIMESTAMP, REC_PET_ID, REC_PET_NAME, REC_CONTENT, REC_SUB_CONTENT, REC_FIELDS };
+constexpr SL_Key kRecordKeys[REC_FIELDS] = {
+    SL_KEY("enumEventType"), SL_KEY("timestamp"), SL_KEY("petId"),
+    SL_KEY("petName"), SL_KEY("content"), SL_KEY("subContent")};
+enum { VISIT_PET_WEIGHT, VISIT_TIME_IN, VISIT_TIME_OUT, VISIT_FIELDS };
+constexpr SL_Key kVisitKeys[VISIT_FIELDS] = {SL_KEY("petWeight"), SL_KEY("timeIn"), SL_KEY("timeOut")};
+enum { LEVEL_LITTER_PERCENT, LEVEL_BOX_FULL, LEVEL_FIELDS };
+constexpr SL_Key kLevelKeys[LEVEL_FIELDS] = {SL_KEY("litterPercent"), SL_KEY("boxFull")};
+
+void petKitBySchema(JsonArray records, std::vector<Decoded>& out) {
+    for (JsonObject record : records) {
+        SL_Fields<REC_FIELDS> f(record, kRecordKeys);
+        if (!f[REC_EVENT_TYPE].as<bool>()) continue;
+        if (!f[REC_PET_ID].as<bool>() || !f[REC_CONTENT].as<bool>()) continue;
+        Decoded d;
+        d.timestamp = f[REC_TIMESTAMP].as<long>();
+        d.pet_id = f[REC_PET_ID].as<int>();
+        d.pet_name = f[REC_PET_NAME].as<String>();
+        SL_Fields<VISIT_FIELDS> visit(f[REC_CONTENT].as<JsonObjectConst>(), kVisitKeys);
+        d.weight = visit[VISIT_PET_WEIGHT].as<int>();
+        d.duration = visit[VISIT_TIME_OUT].as<long>() - visit[VISIT_TIME_IN].as<long>();
+        SL_Fields<LEVEL_FIELDS> level(f[REC_SUB_CONTENT][0]["content"].as<JsonObjectConst>(), kLevelKeys);
+        d.litter_percent = level[LEVEL_LITTER_PERCENT].as<int>();
+        d.box_full = level[LEVEL_BOX_FULL].as<bool>();
+        out.push_back(d);
+    }
+}
+
+void activityByLookup(JsonArray activities, std::vector<Decoded>& out) {
+    for (JsonObject act : activities) {
+        String val = act["value"].as<String>();
+        if (val == "catWeight") continue;
+        Decoded d;
+        if (val == "robotCycleStatusIdle") d.event = "Clean Cycle Complete";
+        else if (val == "DFIFullFlagOn") d.event = "Drawer Full";
+        else d.event = val;
+        d.timestamp = strlen(act["timestamp"].as<const char*>());
+        out.push_back(d);
+    }
+}
+
+enum { ACT_TIMESTAMP, ACT_VALUE, ACT_FIELDS };
+constexpr SL_Key kActivityKeys[ACT_FIELDS] = {SL_KEY("timestamp"), SL_KEY("value")};
+enum { ACTIVITY_CAT_WEIGHT, ACTIVITY_CYCLE_IDLE, ACTIVITY_DFI_FULL };
+constexpr SL_Key kActivityValues[] = {SL_KEY("catWeight"), SL_KEY("robotCycleStatusIdle"), SL_KEY("DFIFullFlagOn")};
+
+void activityBySchema(JsonArray activities, std::vector<Decoded>& out) {
+    for (JsonObject act : activities) {
+        SL_Fields<ACT_FIELDS> f(act, kActivityKeys);
+        JsonString val = f[ACT_VALUE].as<JsonString>();
+        int known = sl_findKey(kActivityValues, val);
+        if (known == ACTIVITY_CAT_WEIGHT) continue;
+        Decoded d;
+        if (known == ACTIVITY_CYCLE_IDLE) d.event = "Clean Cycle Complete";
+        else if (known == ACTIVITY_DFI_FULL) d.event = "Drawer Full";
+        else if (!val.isNull()) d.event = val.c_str();
+        else d.event = f[ACT_VALUE].as<String>();
+        d.timestamp = strlen(f[ACT_TIMESTAMP].as<const char*>());
+        out.push_back(d);
+    }
+}
+
+typedef void (*Decoder)(JsonArray, std::vector<Decoded>&);
+
+// Best of `rounds`, in nanoseconds per record
+double timeDecoder(Decoder decode, JsonArray records, int rounds, size_t& decoded) {
+    std::vector<Decoded> out;
+    out.reserve(records.size());
+    double best = 0;
+    for (int r = 0; r < rounds; r++) {
+        out.clear();
+        auto start = std::chrono::steady_clock::now();
+        decode(records, out);
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        if (r == 0 || ns < best) best = ns;
+    }
+    decoded = out.size();
+    return best / records.size();
+}
+
+void compare(const char* name, JsonArray records, Decoder lookup, Decoder schema, int rounds) {
+    size_t by_lookup, by_schema;
+    double lookup_ns = timeDecoder(lookup, records, rounds, by_lookup);
+    double schema_ns = timeDecoder(schema, records, rounds, by_schema);
+    printf("%-16s lookup %7.1f ns/record   schema %7.1f ns/record   %.2fx%s\n", name, lookup_ns, schema_ns,
+           lookup_ns / schema_ns, by_lookup == by_schema ? "" : "   (record counts differ!)");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int records = 2000;
+    int rounds = 50;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--records") && i + 1 < argc) records = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--rounds") && i + 1 < argc) rounds = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [--records N] [--rounds N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (records < 1 || rounds < 1) return 2;
+
+    JsonDocument petkit;
+    buildPetKitDay(petkit, records);
+    compare("PetKit records", petkit["result"].as<JsonArray>(), petKitByLookup, petKitBySchema, rounds);
+
+    JsonDocument whisker;
+    buildActivity(whisker, records);
+    compare("LR4 activity", whisker["data"]["getLitterRobot4Activity"].as<JsonArray>(), activityByLookup, activityBySchema, rounds);
+    return 0;
+}
@@ -0,0 +1,461 @@
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <malloc.h>
+#include <signal.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "PetKitApi.h"
+#include "WhiskerApi.h"
+#include "RequestScheduler.h"
+#include "StubCloudTransport.h"
+#include "CurlMultiEngine.h"
+#include "TraceBuffer.h"
+
+// Gateway daemon: keeps many households in sync from one Linux process.
+//
+//   litterbox_daemon accounts.json [--workers N] [--window N] [--once] [--verbose]
+//                    [--trace FILE]
+//   litterbox_daemon --bench N [--workers N] [--window N] [--latency MS] [--trace FILE]
+//                    [--tail PERMILLE] [--hedge]
+//
+// accounts.json:
+//   {"accounts": [
+//     {"name": "home", "provider": "petkit", "username": "...", "password": "...",
+//      "region": "us", "timezone": "America/Los_Angeles", "param": 7,
+//      "intervals": {"pets": 86400, "status": 60, "records": 3600}},
+//     {"name": "cabin", "provider": "whisker", "username": "...", "password": "...",
+//      "timezone": "America/Denver", "param": 20}
+//   ]}
+//
+// Accounts are synced by a pool of workers whenever their cadence says a data
+// class is due; an account is never synced by two workers at once. Each
+// account has its own RequestScheduler, since the clouds throttle per account:
+// one household's backoff does not stall the others, and --bench runs at the
+// production rate limits. All HTTP goes through one CurlMultiEngine event loop, and each sync keeps up to
+// --window requests (days, pets, robots) in flight, so workers spend their
+// time waiting on the network rather than holding a core. --window 1 gives
+// the old one-request-at-a-time behaviour. --bench serves every account from
+// its own StubCloudTransport and reports households synced per minute and
+// heap held per account; --tail makes that share (per mille) of stub requests
+// stall for 20x the latency, and --hedge turns on hedged reads. --trace
+// records the most recent sync phases and writes them on exit as a Chrome
+// trace (open in chrome://tracing or Perfetto).
+
+namespace {
+
+struct Account {
+    // The providers keep the const char* they are given, so the strings live here
+    String name;
+    String provider;
+    String username;
+    String password;
+    String region;
+    String timezone;
+    int param = 10;
+
+    std::unique_ptr<StubCloudTransport> stub;
+    std::unique_ptr<RequestScheduler> scheduler;    // Outlives box, which uses it
+    std::unique_ptr<SmartLitterbox> box;
+    bool busy = false;
+    bool ok = false;
+    uint32_t sync_ms = 0;
+};
+
+std::atomic<bool> stopping(false);
+
+void onSignal(int)
+{
+    stopping = true;
+}
+
+size_t heapInUse()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    return mallinfo2().uordblks;
+#else
+    return (size_t)mallinfo().uordblks;
+#endif
+}
+
+const char* eventName(SL_EventType type)
+{
+    switch (type)
+    {
+    case SL_EventType::DEVICE_ONLINE: return "device online";
+    case SL_EventType::DEVICE_OFFLINE: return "device offline";
+    case SL_EventType::STATUS_CHANGED: return "status changed";
+    case SL_EventType::DRAWER_FULL: return "drawer full";
+    case SL_EventType::DRAWER_EMPTIED: return "drawer emptied";
+    case SL_EventType::LITTER_LOW: return "litter low";
+    case SL_EventType::LITTER_REFILLED: return "litter refilled";
+    case SL_EventType::FAULT: return "fault";
+    case SL_EventType::FAULT_CLEARED: return "fault cleared";
+    case SL_EventType::NEW_VISIT: return "new visit";
+    }
+    return "?";
+}
+
+bool createProvider(Account& a, HttpTransport& transport, size_t window, bool hedge, bool verbose)
+{
+    if (a.provider == "petkit")
+    {
+        a.box.reset(new PetKitApi(a.username.c_str(), a.password.c_str(), a.region.c_str(), a.timezone.c_str()));
+    }
+    else if (a.provider == "whisker")
+    {
+        a.box.reset(new WhiskerApi(a.username.c_str(), a.password.c_str(), a.timezone.c_str()));
+    }
+    else
+    {
+        printf("%s: unknown provider '%s'\n", a.name.c_str(), a.provider.c_str());
+        return false;
+    }
+
+    a.scheduler.reset(new RequestScheduler());
+    a.scheduler->setHedging(hedge);
+    if (a.provider == "petkit")
+    {
+        PetKitApi* petkit = static_cast<PetKitApi*>(a.box.get());
+        petkit->setScheduler(*a.scheduler);
+        petkit->setTransport(transport);
+        petkit->setMaxInFlight(window);
+    }
+    else
+    {
+        WhiskerApi* whisker = static_cast<WhiskerApi*>(a.box.get());
+        whisker->setScheduler(*a.scheduler);
+        whisker->setTransport(transport);
+        whisker->setMaxInFlight(window);
+    }
+    a.box->setLogLevel(verbose ? SL_LOG_LEVEL_INFO : SL_LOG_LEVEL_ERROR);
+    return true;
+}
+
+bool loadAccounts(const char* path, HttpTransport& transport, size_t window, bool hedge,
+                  std::vector<std::unique_ptr<Account>>& accounts, bool verbose)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        printf("Cannot open %s\n", path);
+        return false;
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+    std::string json = text.str();
+
+    JsonDocument doc;
+    DeserializationError err = deserializeJson(doc, json.data(), json.size());
+    if (err)
+    {
+        printf("%s: %s\n", path, err.c_str());
+        return false;
+    }
+
+    for (JsonObject cfg : doc["accounts"].as<JsonArray>())
+    {
+        std::unique_ptr<Account> a(new Account());
+        a->name = cfg["name"].as<String>();
+        a->provider = cfg["provider"].as<String>();
+        a->username = cfg["username"].as<String>();
+        a->password = cfg["password"].as<String>();
+        a->region = cfg["region"].isNull() ? String("us") : cfg["region"].as<String>();
+        a->timezone = cfg["timezone"].isNull() ? String("UTC") : cfg["timezone"].as<String>();
+        if (!cfg["param"].isNull()) a->param = cfg["param"].as<int>();
+        if (!createProvider(*a, transport, window, hedge, verbose)) return false;
+
+        JsonObject intervals = cfg["intervals"];
+        SyncCadence& cadence = a->box->cadence();
+        if (!intervals["pets"].isNull()) cadence.setInterval(SL_DataClass::PETS, intervals["pets"].as<unsigned long>());
+        if (!intervals["status"].isNull()) cadence.setInterval(SL_DataClass::STATUS, intervals["status"].as<unsigned long>());
+        if (!intervals["records"].isNull()) cadence.setInterval(SL_DataClass::RECORDS, intervals["records"].as<unsigned long>());
+        accounts.push_back(std::move(a));
+    }
+    return !accounts.empty();
+}
+
+void createBenchAccounts(int count, unsigned long latency_ms, unsigned tail_permille, size_t window, bool hedge,
+                         std::vector<std::unique_ptr<Account>>& accounts)
+{
+    for (int i = 0; i < count; i++)
+    {
+        std::unique_ptr<Account> a(new Account());
+        a->name = String("bench-") + i;
+        a->provider = (i % 2) ? "whisker" : "petkit";
+        a->username = a->name + "@example.com";
+        a->password = "bench";
+        a->region = "us";
+        a->timezone = "America/Los_Angeles";
+        a->param = (i % 2) ? 50 : 30;
+
+        a->stub.reset(new StubCloudTransport());
+        a->stub->setHousehold({2, 3, 60, 4.0f});
+        a->stub->setSeed(0x9E3779B9u * (i + 1));
+        a->stub->setLatency(latency_ms, latency_ms / 2);
+        a->stub->setTailLatency(tail_permille, latency_ms * 20);
+        createProvider(*a, *a->stub, window, hedge, false);
+        accounts.push_back(std::move(a));
+    }
+}
+
+// Workers pull due accounts off a queue; the main thread decides what is due
+class SyncPool {
+public:
+    SyncPool(int workers, bool print_events) : _pending(0), _print_events(print_events)
+    {
+        for (int i = 0; i < workers; i++) _threads.emplace_back([this] { _run(); });
+    }
+
+    ~SyncPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _closed = true;
+        }
+        _work.notify_all();
+        for (auto& t : _threads) t.join();
+    }
+
+    void submit(Account* a)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            a->busy = true;
+            _queue.push_back(a);
+            _pending++;
+        }
+        _work.notify_one();
+    }
+
+    bool busy(Account* a)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return a->busy;
+    }
+
+    // Wait until the queue drains, or at most timeout_ms
+    void wait(unsigned long timeout_ms)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _done.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this] { return _pending == 0; });
+    }
+
+    void waitAll()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _done.wait(lock, [this] { return _pending == 0; });
+    }
+
+private:
+    void _run()
+    {
+        while (true)
+        {
+            Account* a;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _work.wait(lock, [this] { return _closed || !_queue.empty(); });
+                if (_queue.empty()) return;
+                a = _queue.front();
+                _queue.pop_front();
+            }
+
+            uint32_t start = millis();
+            a->ok = a->box->fetchAllData(a->param);
+            a->sync_ms = millis() - start;
+            if (_print_events)
+            {
+                printf("%s: sync %s in %u ms, %u records\n", a->name.c_str(), a->ok ? "ok" : "failed",
+                       (unsigned)a->sync_ms, (unsigned)a->box->recordCount());
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                a->busy = false;
+                _pending--;
+            }
+            _done.notify_all();
+        }
+    }
+
+    std::vector<std::thread> _threads;
+    std::deque<Account*> _queue;
+    std::mutex _mutex;
+    std::condition_variable _work;
+    std::condition_variable _done;
+    int _pending;
+    bool _closed = false;
+    bool _print_events;
+};
+
+double runRound(SyncPool& pool, std::vector<std::unique_ptr<Account>>& accounts)
+{
+    uint32_t start = millis();
+    for (auto& a : accounts) pool.submit(a.get());
+    pool.waitAll();
+    return (millis() - start) / 1000.0;
+}
+
+int runBench(int count, int workers, size_t window, unsigned long latency_ms, unsigned tail_permille, bool hedge)
+{
+    size_t heap_before = heapInUse();
+    std::vector<std::unique_ptr<Account>> accounts;
+    createBenchAccounts(count, latency_ms, tail_permille, window, hedge, accounts);
+    SyncPool pool(workers, false);
+
+    printf("Bench: %d households, %d workers, %u in flight per sync, %lu ms stub latency\n",
+           count, workers, (unsigned)window, latency_ms);
+    const char* rounds[] = {"first sync", "incremental"};
+    for (const char* label : rounds)
+    {
+        double seconds = runRound(pool, accounts);
+        int failed = 0;
+        size_t records = 0;
+        unsigned long requests = 0;
+        std::vector<uint32_t> sync_ms;
+        for (auto& a : accounts)
+        {
+            sync_ms.push_back(a->sync_ms);
+            if (!a->ok) failed++;
+            records += a->box->recordCount();
+            requests += a->stub->requestCount();
+            a->box->invalidate();
+        }
+        size_t heap = heapInUse() - heap_before;
+        std::sort(sync_ms.begin(), sync_ms.end());
+        printf("  %-12s %.2f s, %.0f households/min, %d failed, %lu requests so far, "
+               "%zu records, %zu bytes/account\n"
+               "  %-12s sync time p50 %u / p95 %u / max %u ms\n",
+               label, seconds, seconds > 0 ? count * 60.0 / seconds : 0.0, failed, requests,
+               records, heap / (size_t)count, "",
+               (unsigned)sync_ms[sync_ms.size() / 2], (unsigned)sync_ms[sync_ms.size() * 95 / 100],
+               (unsigned)sync_ms.back());
+    }
+    return 0;
+}
+
+int runDaemon(const char* path, int workers, size_t window, bool hedge, bool once, bool verbose)
+{
+    CurlMultiEngine engine;
+    std::vector<std::unique_ptr<Account>> accounts;
+    if (!loadAccounts(path, engine, window, hedge, accounts, verbose)) return 1;
+
+    for (auto& a : accounts)
+    {
+        Account* acct = a.get();
+        a->box->onEvent([acct](const SL_Event& e) {
+            if (e.type == SL_EventType::NEW_VISIT && e.record)
+            {
+                printf("%s: %s %s, %.2f lbs\n", acct->name.c_str(), eventName(e.type),
+                       e.record->pet_name, e.record->weight_lbs);
+            }
+            else
+            {
+                printf("%s: %s %s\n", acct->name.c_str(), e.device ? e.device : "", eventName(e.type));
+            }
+        });
+    }
+
+    SyncPool pool(workers, verbose);
+    printf("Syncing %zu accounts with %d workers\n", accounts.size(), workers);
+
+    if (once)
+    {
+        runRound(pool, accounts);
+        int failed = 0;
+        for (auto& a : accounts) failed += a->ok ? 0 : 1;
+        return failed ? 1 : 0;
+    }
+
+    while (!stopping)
+    {
+        time_t now = time(nullptr);
+        time_t wake = now + 60;
+        for (auto& a : accounts)
+        {
+            if (pool.busy(a.get())) continue;
+            time_t due = a->box->cadence().nextDue(now);
+            if (due <= now) pool.submit(a.get());
+            else if (due < wake) wake = due;
+        }
+        // Wake early when a sync finishes, so follow-up work is not delayed
+        pool.wait((unsigned long)(wake - now) * 1000UL);
+        if (time(nullptr) < wake && !stopping) delay(200);
+    }
+    printf("Stopping; waiting for running syncs\n");
+    pool.waitAll();
+    engine.printStats(Serial);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const char* config = nullptr;
+    int workers = 4;
+    int window = 8;
+    int bench = 0;
+    unsigned long latency_ms = 50;
+    unsigned tail_permille = 0;
+    bool hedge = false;
+    bool once = false;
+    bool verbose = false;
+    const char* trace_path = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        String arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--workers" && has_value) workers = atoi(argv[++i]);
+        else if (arg == "--window" && has_value) window = atoi(argv[++i]);
+        else if (arg == "--bench" && has_value) bench = atoi(argv[++i]);
+        else if (arg == "--latency" && has_value) latency_ms = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--tail" && has_value) tail_permille = (unsigned)atoi(argv[++i]);
+        else if (arg == "--hedge") hedge = true;
+        else if (arg == "--once") once = true;
+        else if (arg == "--verbose") verbose = true;
+        else if (arg == "--trace" && has_value) trace_path = argv[++i];
+        else if (!arg.startsWith("--")) config = argv[i];
+        else
+        {
+            printf("Unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (workers < 1) workers = 1;
+    if (window < 1) window = 1;
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    if (bench <= 0 && !config)
+    {
+        printf("usage: %s accounts.json [--workers N] [--window N] [--once] [--verbose] [--trace FILE]\n"
+               "       %s --bench N [--workers N] [--window N] [--latency MS] [--trace FILE]\n"
+               "           [--tail PERMILLE] [--hedge]\n",
+               argv[0], argv[0]);
+        return 2;
+    }
+    if (trace_path) TraceBuffer::shared().setEnabled(true);
+
+    int rc = bench > 0 ? runBench(bench, workers, (size_t)window, latency_ms, tail_permille, hedge)
+                       : runDaemon(config, workers, (size_t)window, hedge, once, verbose);
+
+    if (trace_path)
+    {
+        if (TraceBuffer::shared().exportChrome(trace_path))
+            printf("Wrote %zu trace spans to %s\n", TraceBuffer::shared().size(), trace_path);
+        else
+            printf("Could not write %s\n", trace_path);
+    }
+    return rc;
+}
@@ -0,0 +1,98 @@
+#include "Arduino.h"
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <thread>
+
+HostSerial Serial;
+
+static const auto start_time = std::chrono::steady_clock::now();
+
+unsigned long millis()
+{
+    return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time).count();
+}
+
+unsigned long micros()
+{
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_time).count();
+}
+
+void delay(unsigned long ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void yield()
+{
+    std::this_thread::yield();
+}
+
+// --- Random ---
+
+static std::mutex rng_mutex;
+static std::mt19937 rng(std::random_device{}());
+
+long random(long max)
+{
+    if (max <= 0) return 0;
+    std::lock_guard<std::mutex> lock(rng_mutex);
+    return std::uniform_int_distribution<long>(0, max - 1)(rng);
+}
+
+long random(long min, long max)
+{
+    if (max <= min) return min;
+    return min + random(max - min);
+}
+
+void randomSeed(unsigned long seed)
+{
+    std::lock_guard<std::mutex> lock(rng_mutex);
+    rng.seed(seed);
+}
+
+// --- Serial ---
+
+size_t HostSerial::write(uint8_t c)
+{
+    return fputc(c, stdout) == EOF ? 0 : 1;
+}
+
+size_t HostSerial::write(const uint8_t* buffer, size_t size)
+{
+    return fwrite(buffer, 1, size, stdout);
+}
+
+void HostSerial::flush()
+{
+    fflush(stdout);
+}
+
+// --- Stream ---
+
+int Stream::timedRead()
+{
+    unsigned long start = millis();
+    do
+    {
+        int c = read();
+        if (c >= 0) return c;
+        yield();
+    } while (millis() - start < _timeout);
+    return -1;
+}
+
+size_t Stream::readBytes(char* buffer, size_t length)
+{
+    size_t count = 0;
+    while (count < length)
+    {
+        int c = timedRead();
+        if (c < 0) break;
+        buffer[count++] = (char)c;
+    }
+    return count;
+}
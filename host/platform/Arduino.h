@@ -0,0 +1,52 @@
+#ifndef Arduino_h
+#define Arduino_h
+
+// Minimal Arduino core for building the library on Linux (see host/README.md).
+// Only what src/ uses is provided; anything touching WiFi or pins is an ESP32
+// concern and stays out of the host build.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "WString.h"
+#include "Print.h"
+#include "Stream.h"
+
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+// No GPIO on the host; the status LED option is accepted and ignored
+inline void pinMode(int, int) {}
+inline void digitalWrite(int, int) {}
+inline int digitalRead(int) { return LOW; }
+
+// Serial writes to stdout
+class HostSerial : public Print {
+public:
+    void begin(unsigned long) {}
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    void flush() override;
+    operator bool() const { return true; }
+};
+
+extern HostSerial Serial;
+
+#endif
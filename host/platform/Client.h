@@ -0,0 +1,13 @@
+#ifndef Client_h
+#define Client_h
+
+#include "Stream.h"
+
+// Host stand-in for the Arduino Client interface (only what the library uses)
+class Client : public Stream {
+public:
+    virtual uint8_t connected() = 0;
+    virtual void stop() = 0;
+};
+
+#endif
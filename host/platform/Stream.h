@@ -0,0 +1,25 @@
+#ifndef Stream_h
+#define Stream_h
+
+#include "Print.h"
+
+// Host stand-in for the Arduino Stream base class
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeout_ms) { _timeout = timeout_ms; }
+    unsigned long getTimeout() const { return _timeout; }
+
+    virtual size_t readBytes(char* buffer, size_t length);
+    size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+
+protected:
+    int timedRead();
+
+    unsigned long _timeout = 1000;
+};
+
+#endif
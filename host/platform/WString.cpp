@@ -0,0 +1,111 @@
+#include "WString.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static std::string formatInteger(unsigned long long value, bool negative, unsigned char base)
+{
+    if (base < 2 || base > 36) base = 10;
+    char buf[72];
+    int pos = sizeof(buf);
+    buf[--pos] = 0;
+    do
+    {
+        int digit = value % base;
+        buf[--pos] = digit < 10 ? '0' + digit : 'a' + digit - 10;
+        value /= base;
+    } while (value);
+    if (negative) buf[--pos] = '-';
+    return std::string(buf + pos);
+}
+
+static std::string formatSigned(long long value, unsigned char base)
+{
+    // Arduino prints negatives with a sign in base 10 only
+    if (value < 0 && base == 10) return formatInteger(0ULL - (unsigned long long)value, true, base);
+    return formatInteger((unsigned long long)value, false, base);
+}
+
+String::String(int value, unsigned char base) : _s(formatSigned(value, base)) {}
+String::String(unsigned int value, unsigned char base) : _s(formatInteger(value, false, base)) {}
+String::String(long value, unsigned char base) : _s(formatSigned(value, base)) {}
+String::String(unsigned long value, unsigned char base) : _s(formatInteger(value, false, base)) {}
+String::String(long long value, unsigned char base) : _s(formatSigned(value, base)) {}
+String::String(unsigned long long value, unsigned char base) : _s(formatInteger(value, false, base)) {}
+
+String::String(float value, unsigned int decimals) : String((double)value, decimals) {}
+
+String::String(double value, unsigned int decimals)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", (int)decimals, value);
+    _s = buf;
+}
+
+bool String::endsWith(const String& suffix) const
+{
+    if (suffix._s.size() > _s.size()) return false;
+    return _s.compare(_s.size() - suffix._s.size(), suffix._s.size(), suffix._s) == 0;
+}
+
+String String::substring(unsigned int from, unsigned int to) const
+{
+    if (from > to) std::swap(from, to);
+    if (from >= _s.size()) return String();
+    return String(_s.substr(from, to - from));
+}
+
+void String::replace(const String& find, const String& replace)
+{
+    if (find._s.empty()) return;
+    size_t pos = 0;
+    while ((pos = _s.find(find._s, pos)) != std::string::npos)
+    {
+        _s.replace(pos, find._s.size(), replace._s);
+        pos += replace._s.size();
+    }
+}
+
+void String::toLowerCase()
+{
+    for (auto& c : _s) c = tolower((unsigned char)c);
+}
+
+void String::toUpperCase()
+{
+    for (auto& c : _s) c = toupper((unsigned char)c);
+}
+
+void String::trim()
+{
+    size_t first = 0;
+    while (first < _s.size() && isspace((unsigned char)_s[first])) first++;
+    size_t last = _s.size();
+    while (last > first && isspace((unsigned char)_s[last - 1])) last--;
+    _s = _s.substr(first, last - first);
+}
+
+long String::toInt() const
+{
+    return strtol(_s.c_str(), nullptr, 10);
+}
+
+float String::toFloat() const
+{
+    return (float)toDouble();
+}
+
+double String::toDouble() const
+{
+    return strtod(_s.c_str(), nullptr);
+}
+
+bool String::equalsIgnoreCase(const String& str) const
+{
+    if (_s.size() != str._s.size()) return false;
+    for (size_t i = 0; i < _s.size(); i++)
+    {
+        if (tolower((unsigned char)_s[i]) != tolower((unsigned char)str._s[i])) return false;
+    }
+    return true;
+}
@@ -0,0 +1,97 @@
+#ifndef WString_h
+#define WString_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// Host stand-in for the Arduino String, backed by std::string. Covers the
+// API used by the library and by ArduinoJson's String adapters.
+
+class String {
+public:
+    String() {}
+    String(const char* str) : _s(str ? str : "") {}
+    String(const char* str, size_t length) : _s(str ? std::string(str, length) : std::string()) {}
+    String(const std::string& str) : _s(str) {}
+    explicit String(char c) : _s(1, c) {}
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(long long value, unsigned char base = 10);
+    explicit String(unsigned long long value, unsigned char base = 10);
+    explicit String(float value, unsigned int decimals = 2);
+    explicit String(double value, unsigned int decimals = 2);
+
+    String& operator=(const char* str) { _s = str ? str : ""; return *this; }
+
+    const char* c_str() const { return _s.c_str(); }
+    unsigned int length() const { return (unsigned int)_s.size(); }
+    bool isEmpty() const { return _s.empty(); }
+    bool reserve(unsigned int size) { _s.reserve(size); return true; }
+
+    bool concat(const String& str) { _s += str._s; return true; }
+    bool concat(const char* str) { if (str) _s += str; return true; }
+    bool concat(const char* str, unsigned int length) { if (str) _s.append(str, length); return true; }
+    bool concat(char c) { _s += c; return true; }
+    String& operator+=(const String& str) { concat(str); return *this; }
+    String& operator+=(const char* str) { concat(str); return *this; }
+    String& operator+=(char c) { concat(c); return *this; }
+
+    bool equals(const String& str) const { return _s == str._s; }
+    bool equals(const char* str) const { return _s == (str ? str : ""); }
+    bool equalsIgnoreCase(const String& str) const;
+    bool operator==(const String& str) const { return equals(str); }
+    bool operator==(const char* str) const { return equals(str); }
+    bool operator!=(const String& str) const { return !equals(str); }
+    bool operator!=(const char* str) const { return !equals(str); }
+    bool operator<(const String& str) const { return _s < str._s; }
+    bool operator>(const String& str) const { return _s > str._s; }
+    int compareTo(const String& str) const { return _s.compare(str._s); }
+
+    char charAt(unsigned int index) const { return index < _s.size() ? _s[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    char& operator[](unsigned int index) { return _s[index]; }
+
+    bool startsWith(const String& prefix) const { return _s.compare(0, prefix._s.size(), prefix._s) == 0; }
+    bool endsWith(const String& suffix) const;
+
+    int indexOf(char c, unsigned int from = 0) const { return _find(_s.find(c, from)); }
+    int indexOf(const String& str, unsigned int from = 0) const { return _find(_s.find(str._s, from)); }
+    int lastIndexOf(char c) const { return _find(_s.rfind(c)); }
+    int lastIndexOf(const String& str) const { return _find(_s.rfind(str._s)); }
+
+    String substring(unsigned int from) const { return from < _s.size() ? String(_s.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const;
+
+    void remove(unsigned int index) { if (index < _s.size()) _s.erase(index); }
+    void remove(unsigned int index, unsigned int count) { if (index < _s.size()) _s.erase(index, count); }
+    void replace(const String& find, const String& replace);
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+    long toInt() const;
+    float toFloat() const;
+    double toDouble() const;
+
+    const std::string& str() const { return _s; }
+
+private:
+    static int _find(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+    std::string _s;
+};
+
+inline String operator+(const String& a, const String& b) { String r(a); r.concat(b); return r; }
+inline String operator+(const String& a, const char* b) { String r(a); r.concat(b); return r; }
+inline String operator+(const char* a, const String& b) { String r(a); r.concat(b); return r; }
+inline String operator+(const String& a, char b) { String r(a); r.concat(b); return r; }
+inline String operator+(const String& a, int b) { return a + String(b); }
+inline String operator+(const String& a, unsigned int b) { return a + String(b); }
+inline String operator+(const String& a, long b) { return a + String(b); }
+inline String operator+(const String& a, unsigned long b) { return a + String(b); }
+inline String operator+(const String& a, float b) { return a + String(b); }
+inline String operator+(const String& a, double b) { return a + String(b); }
+
+#endif
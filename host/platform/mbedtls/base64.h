@@ -0,0 +1,15 @@
+#ifndef SL_HOST_MBEDTLS_BASE64_H
+#define SL_HOST_MBEDTLS_BASE64_H
+
+// The subset of the mbedTLS base64 API used by WhiskerApi (JWT payloads),
+// implemented in host/platform/mbedtls_compat.cpp
+
+#include <stddef.h>
+
+#define MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL -0x002A
+#define MBEDTLS_ERR_BASE64_INVALID_CHARACTER -0x002C
+
+int mbedtls_base64_encode(unsigned char* dst, size_t dlen, size_t* olen, const unsigned char* src, size_t slen);
+int mbedtls_base64_decode(unsigned char* dst, size_t dlen, size_t* olen, const unsigned char* src, size_t slen);
+
+#endif
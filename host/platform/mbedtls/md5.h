@@ -0,0 +1,27 @@
+#ifndef SL_HOST_MBEDTLS_MD5_H
+#define SL_HOST_MBEDTLS_MD5_H
+
+// The subset of the mbedTLS MD5 API used by PetKitApi (password hashing),
+// implemented in host/platform/mbedtls_compat.cpp
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    uint32_t state[4];
+    uint64_t length;
+    unsigned char buffer[64];
+} mbedtls_md5_context;
+
+void mbedtls_md5_init(mbedtls_md5_context* ctx);
+void mbedtls_md5_free(mbedtls_md5_context* ctx);
+int mbedtls_md5_starts_ret(mbedtls_md5_context* ctx);
+int mbedtls_md5_update_ret(mbedtls_md5_context* ctx, const unsigned char* input, size_t ilen);
+int mbedtls_md5_finish_ret(mbedtls_md5_context* ctx, unsigned char output[16]);
+
+// Pre-3.0 names, as used with the ESP32 core
+inline int mbedtls_md5_starts(mbedtls_md5_context* ctx) { return mbedtls_md5_starts_ret(ctx); }
+inline void mbedtls_md5_update(mbedtls_md5_context* ctx, const unsigned char* input, size_t ilen) { mbedtls_md5_update_ret(ctx, input, ilen); }
+inline void mbedtls_md5_finish(mbedtls_md5_context* ctx, unsigned char output[16]) { mbedtls_md5_finish_ret(ctx, output); }
+
+#endif
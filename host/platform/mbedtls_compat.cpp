@@ -0,0 +1,181 @@
+#include "mbedtls/md5.h"
+#include "mbedtls/base64.h"
+#include <string.h>
+
+// --- MD5 (RFC 1321) ---
+
+static const uint32_t md5_k[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391};
+
+static const uint8_t md5_r[64] = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21};
+
+static void md5_block(uint32_t state[4], const unsigned char block[64])
+{
+    uint32_t w[16];
+    for (int i = 0; i < 16; i++)
+    {
+        w[i] = (uint32_t)block[i * 4] | ((uint32_t)block[i * 4 + 1] << 8) |
+               ((uint32_t)block[i * 4 + 2] << 16) | ((uint32_t)block[i * 4 + 3] << 24);
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    for (int i = 0; i < 64; i++)
+    {
+        uint32_t f;
+        int g;
+        if (i < 16) { f = (b & c) | (~b & d); g = i; }
+        else if (i < 32) { f = (d & b) | (~d & c); g = (5 * i + 1) % 16; }
+        else if (i < 48) { f = b ^ c ^ d; g = (3 * i + 5) % 16; }
+        else { f = c ^ (b | ~d); g = (7 * i) % 16; }
+
+        uint32_t tmp = d;
+        d = c;
+        c = b;
+        uint32_t x = a + f + md5_k[i] + w[g];
+        b = b + ((x << md5_r[i]) | (x >> (32 - md5_r[i])));
+        a = tmp;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+}
+
+void mbedtls_md5_init(mbedtls_md5_context* ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_md5_free(mbedtls_md5_context* ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+int mbedtls_md5_starts_ret(mbedtls_md5_context* ctx)
+{
+    ctx->state[0] = 0x67452301;
+    ctx->state[1] = 0xefcdab89;
+    ctx->state[2] = 0x98badcfe;
+    ctx->state[3] = 0x10325476;
+    ctx->length = 0;
+    return 0;
+}
+
+int mbedtls_md5_update_ret(mbedtls_md5_context* ctx, const unsigned char* input, size_t ilen)
+{
+    size_t used = ctx->length % 64;
+    ctx->length += ilen;
+    while (ilen > 0)
+    {
+        size_t take = 64 - used < ilen ? 64 - used : ilen;
+        memcpy(ctx->buffer + used, input, take);
+        used += take;
+        input += take;
+        ilen -= take;
+        if (used == 64)
+        {
+            md5_block(ctx->state, ctx->buffer);
+            used = 0;
+        }
+    }
+    return 0;
+}
+
+int mbedtls_md5_finish_ret(mbedtls_md5_context* ctx, unsigned char output[16])
+{
+    uint64_t bits = ctx->length * 8;
+    static const unsigned char pad[64] = {0x80};
+    size_t used = ctx->length % 64;
+    size_t pad_len = (used < 56) ? 56 - used : 120 - used;
+    mbedtls_md5_update_ret(ctx, pad, pad_len);
+
+    unsigned char len_le[8];
+    for (int i = 0; i < 8; i++) len_le[i] = (unsigned char)(bits >> (8 * i));
+    mbedtls_md5_update_ret(ctx, len_le, 8);
+
+    for (int i = 0; i < 4; i++)
+    {
+        for (int j = 0; j < 4; j++) output[i * 4 + j] = (unsigned char)(ctx->state[i] >> (8 * j));
+    }
+    return 0;
+}
+
+// --- Base64 ---
+
+static const char b64_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static int b64_value(unsigned char c)
+{
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+int mbedtls_base64_encode(unsigned char* dst, size_t dlen, size_t* olen, const unsigned char* src, size_t slen)
+{
+    size_t need = 4 * ((slen + 2) / 3) + 1;
+    *olen = need;
+    if (!dst || dlen < need) return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+
+    size_t o = 0;
+    for (size_t i = 0; i < slen; i += 3)
+    {
+        uint32_t v = (uint32_t)src[i] << 16;
+        if (i + 1 < slen) v |= (uint32_t)src[i + 1] << 8;
+        if (i + 2 < slen) v |= src[i + 2];
+        dst[o++] = b64_alphabet[(v >> 18) & 63];
+        dst[o++] = b64_alphabet[(v >> 12) & 63];
+        dst[o++] = i + 1 < slen ? b64_alphabet[(v >> 6) & 63] : '=';
+        dst[o++] = i + 2 < slen ? b64_alphabet[v & 63] : '=';
+    }
+    dst[o] = 0;
+    *olen = o;
+    return 0;
+}
+
+int mbedtls_base64_decode(unsigned char* dst, size_t dlen, size_t* olen, const unsigned char* src, size_t slen)
+{
+    // Same contract as mbedTLS: with dst == NULL or too small, report the size needed
+    size_t symbols = 0;
+    for (size_t i = 0; i < slen; i++)
+    {
+        if (src[i] == '=' || src[i] == '\r' || src[i] == '\n') continue;
+        if (b64_value(src[i]) < 0) return MBEDTLS_ERR_BASE64_INVALID_CHARACTER;
+        symbols++;
+    }
+    size_t need = symbols * 6 / 8;
+    *olen = need;
+    if (!dst || dlen < need) return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+
+    uint32_t acc = 0;
+    int bits = 0;
+    size_t o = 0;
+    for (size_t i = 0; i < slen; i++)
+    {
+        int v = b64_value(src[i]);
+        if (v < 0) continue;
+        acc = (acc << 6) | (uint32_t)v;
+        bits += 6;
+        if (bits >= 8)
+        {
+            bits -= 8;
+            dst[o++] = (unsigned char)(acc >> bits);
+        }
+    }
+    *olen = o;
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include "ChangeDetector.h"
+
+void ChangeDetector::beginRound()
+{
+    for (auto& d : _devices) d.seen = false;
+}
+
+void ChangeDetector::observe(const SL_Status& status, const SL_EventCallback& emit)
+{
+    bool created;
+    Device& d = _find(status.device_name, created);
+    d.seen = true;
+
+    if (!d.online)
+    {
+        d.online = true;
+        _emit(emit, SL_EventType::DEVICE_ONLINE, d, &status, d.has_status ? &d.last : nullptr);
+    }
+
+    if (d.has_status)
+    {
+        const SL_Status& prev = d.last;
+        if (status.status_text != prev.status_text)
+            _emit(emit, SL_EventType::STATUS_CHANGED, d, &status, &prev);
+        if (status.is_drawer_full != prev.is_drawer_full)
+            _emit(emit, status.is_drawer_full ? SL_EventType::DRAWER_FULL : SL_EventType::DRAWER_EMPTIED, d, &status, &prev);
+        if (status.is_error_state != prev.is_error_state)
+            _emit(emit, status.is_error_state ? SL_EventType::FAULT : SL_EventType::FAULT_CLEARED, d, &status, &prev);
+
+        bool low = status.litter_level_percent < _litter_low_percent;
+        bool was_low = prev.litter_level_percent < _litter_low_percent;
+        if (low != was_low)
+            _emit(emit, low ? SL_EventType::LITTER_LOW : SL_EventType::LITTER_REFILLED, d, &status, &prev);
+    }
+
+    d.last = status;
+    d.has_status = true;
+}
+
+void ChangeDetector::observePresent(const String& device_name, const SL_EventCallback& emit)
+{
+    bool created;
+    Device& d = _find(device_name, created);
+    d.seen = true;
+    if (created) d.last.device_name = device_name;
+
+    if (!d.online)
+    {
+        d.online = true;
+        _emit(emit, SL_EventType::DEVICE_ONLINE, d, d.has_status ? &d.last : nullptr, nullptr);
+    }
+}
+
+void ChangeDetector::endRound(const SL_EventCallback& emit)
+{
+    for (auto& d : _devices)
+    {
+        if (d.seen || !d.online) continue;
+        d.online = false;
+        _emit(emit, SL_EventType::DEVICE_OFFLINE, d, nullptr, d.has_status ? &d.last : nullptr);
+    }
+}
+
+// --- Private Helper Methods ---
+
+ChangeDetector::Device& ChangeDetector::_find(const String& device_name, bool& created)
+{
+    for (auto& d : _devices)
+    {
+        if (d.last.device_name == device_name)
+        {
+            created = false;
+            return d;
+        }
+    }
+    Device d = {};
+    d.last.device_name = device_name;
+    _devices.push_back(d);
+    created = true;
+    return _devices.back();
+}
+
+void ChangeDetector::_emit(const SL_EventCallback& emit, SL_EventType type, const Device& d,
+                           const SL_Status* status, const SL_Status* previous)
+{
+    if (!emit) return;
+    emit(SL_Event{type, d.last.device_name.c_str(), status, previous, nullptr});
+}
@@ -0,0 +1,47 @@
+#ifndef ChangeDetector_h
+#define ChangeDetector_h
+
+#include <Arduino.h>
+#include "SmartLitterbox.h"
+#include <vector>
+
+// Remembers the last status of each device and turns the next fetch into
+// SL_Events. A provider brackets each successful fetch with beginRound() /
+// endRound() and reports every device it listed in between. Devices not
+// reported in a round are considered offline.
+//
+// The first observation of a device only yields DEVICE_ONLINE; there is
+// nothing to compare its fields against yet.
+
+class ChangeDetector {
+public:
+    ChangeDetector() : _litter_low_percent(20) {}
+
+    void setLitterLowThreshold(int percent) { _litter_low_percent = percent; }
+
+    void beginRound();
+    // Device listed with a current status
+    void observe(const SL_Status& status, const SL_EventCallback& emit);
+    // Device listed, but this fetch produced no status for it
+    void observePresent(const String& device_name, const SL_EventCallback& emit);
+    void endRound(const SL_EventCallback& emit);
+
+    void clear() { _devices.clear(); }
+
+private:
+    struct Device {
+        SL_Status last;
+        bool has_status;
+        bool online;
+        bool seen;
+    };
+
+    Device& _find(const String& device_name, bool& created);
+    static void _emit(const SL_EventCallback& emit, SL_EventType type, const Device& d,
+                      const SL_Status* status, const SL_Status* previous);
+
+    std::vector<Device> _devices;   // A household has a handful; linear search
+    int _litter_low_percent;
+};
+
+#endif
@@ -0,0 +1,182 @@
+#include "DailyRollupStore.h"
+#include <algorithm>
+
+DailyRollupStore::DailyRollupStore()
+    : _raw_days(0),
+      _compacted_through(0),
+      _revision(0),
+      _name_storage(std::make_shared<std::deque<String>>())
+{
+}
+
+void DailyRollupStore::clear()
+{
+    _rollups.clear();
+    // Published copies keep the old names alive
+    _name_storage = std::make_shared<std::deque<String>>();
+    _pet_names.clear();
+    _types.clear();
+    _compacted_through = 0;
+    _revision++;
+}
+
+uint32_t DailyRollupStore::dayOf(time_t ts)
+{
+    struct tm t;
+    localtime_r(&ts, &t);
+    return (uint32_t)(t.tm_year + 1900) * 10000 + (t.tm_mon + 1) * 100 + t.tm_mday;
+}
+
+time_t DailyRollupStore::dayStart(time_t now, int days)
+{
+    struct tm t;
+    localtime_r(&now, &t);
+    t.tm_mday -= days;
+    t.tm_hour = 0;
+    t.tm_min = 0;
+    t.tm_sec = 0;
+    t.tm_isdst = -1;
+    return mktime(&t); // Normalizes month rollovers
+}
+
+time_t DailyRollupStore::compact(const SL_RecordSource& records, time_t now)
+{
+    if (_raw_days <= 0) return 0;
+
+    // Whole days only, so a day is never split between raw and rolled up
+    time_t cutoff = dayStart(now, _raw_days);
+    if (cutoff <= _compacted_through) return _compacted_through;
+
+    // Every stored entry, so the caller can drop all raw records before cutoff
+    SL_RecordView r;
+    for (size_t i = 0; i < records.recordCount(); i++)
+    {
+        if (!records.entryAt(i, r)) continue;
+        if (r.timestamp >= _compacted_through && r.timestamp < cutoff) _fold(_rollups, r, _addName(r.pet_name), _addType(r.action));
+    }
+    _compacted_through = cutoff;
+    _revision++;
+    return cutoff;
+}
+
+bool DailyRollupStore::foldLate(const SL_RecordView& r)
+{
+    if (_raw_days <= 0 || r.timestamp >= _compacted_through) return false;
+    _fold(_rollups, r, _addName(r.pet_name), _addType(r.action));
+    _revision++;
+    return true;
+}
+
+void DailyRollupStore::addNames(const SL_RecordSource& records)
+{
+    SL_RecordView r;
+    for (size_t i = 0; i < records.recordCount(); i++)
+    {
+        if (!records.entryAt(i, r)) continue;
+        _addName(r.pet_name);
+        _addType(r.action);
+    }
+}
+
+void DailyRollupStore::query(const SL_RecordSource& records, time_t from, time_t to, std::vector<SL_DailyRollup>& out) const
+{
+    out.clear();
+    uint32_t first = dayOf(from);
+    uint32_t last = dayOf(to);
+    for (const auto& d : _rollups)
+    {
+        if (d.day >= first && d.day <= last) out.push_back(d);
+    }
+
+    // Recent days are summarized from the raw records on the fly
+    SL_RecordView r;
+    for (size_t i = 0; i < records.recordCount(); i++)
+    {
+        if (!records.entryAt(i, r)) continue;
+        if (r.timestamp < from || r.timestamp > to || r.timestamp < _compacted_through) continue;
+        // Unregistered types land in the last slot with the overflow
+        int type = _findType(r.action);
+        _fold(out, r, _findName(r.pet_name), type >= 0 ? type : SL_ROLLUP_MAX_TYPES - 1);
+    }
+}
+
+// --- Private Helper Methods ---
+
+void DailyRollupStore::_fold(std::vector<SL_DailyRollup>& into, const SL_RecordView& r, const char* pet_name, uint8_t type)
+{
+    uint32_t day = dayOf(r.timestamp);
+    auto it = std::lower_bound(into.begin(), into.end(), day, [&](const SL_DailyRollup& d, uint32_t key) {
+        return d.day < key || (d.day == key && d.PetId < r.PetId);
+    });
+
+    if (it == into.end() || it->day != day || it->PetId != r.PetId)
+    {
+        SL_DailyRollup d = {};
+        d.day = day;
+        d.PetId = r.PetId;
+        d.pet_name = pet_name;
+        it = into.insert(it, d);
+    }
+
+    it->visits++;
+    if (r.weight_lbs > 0)
+    {
+        if (it->weighed == 0 || r.weight_lbs < it->weight_min_lbs) it->weight_min_lbs = r.weight_lbs;
+        if (r.weight_lbs > it->weight_max_lbs) it->weight_max_lbs = r.weight_lbs;
+        it->weight_sum_lbs += r.weight_lbs;
+        it->weighed++;
+    }
+    if (r.duration_seconds > 0) it->duration_seconds += (uint32_t)r.duration_seconds;
+    it->type_counts[type]++;
+}
+
+const char* DailyRollupStore::_findName(const char* name) const
+{
+    if (!name) name = "";
+    for (const char* n : _pet_names)
+    {
+        if (strcmp(n, name) == 0) return n;
+    }
+    return "";
+}
+
+const char* DailyRollupStore::_addName(const char* name)
+{
+    if (!name) name = "";
+    for (const char* n : _pet_names)
+    {
+        if (strcmp(n, name) == 0) return n;
+    }
+    _name_storage->push_back(String(name));
+    _pet_names.push_back(_name_storage->back().c_str());
+    _revision++;
+    return _pet_names.back();
+}
+
+int DailyRollupStore::_findType(const char* action) const
+{
+    if (!action) action = "";
+    for (size_t i = 0; i < _types.size(); i++)
+    {
+        if (strcmp(_types[i].c_str(), action) == 0) return i;
+    }
+    return -1;
+}
+
+uint8_t DailyRollupStore::_addType(const char* action)
+{
+    int found = _findType(action);
+    if (found >= 0) return found;
+    if (_types.size() < SL_ROLLUP_MAX_TYPES - 1)
+    {
+        _types.push_back(String(action ? action : ""));
+        _revision++;
+        return _types.size() - 1;
+    }
+    if (_types.size() == SL_ROLLUP_MAX_TYPES - 1)
+    {
+        _types.push_back(String("Other"));
+        _revision++;
+    }
+    return SL_ROLLUP_MAX_TYPES - 1;
+}
@@ -0,0 +1,85 @@
+// Outside the guard: SmartLitterbox.h includes this file at its end
+#include "SmartLitterbox.h"
+
+#ifndef DailyRollupStore_h
+#define DailyRollupStore_h
+
+#include <Arduino.h>
+#include <deque>
+#include <memory>
+#include <vector>
+
+// Compact long-term history. Providers keep raw records for the last
+// setRawRetentionDays() local days and fold everything older into one
+// SL_DailyRollup per pet per day, so memory grows with days, not visits.
+//
+// Compaction only ever moves forward: records older than compactedThrough()
+// have already been counted and are ignored, so providers that refetch a
+// window of days (PetKit) do not count a day twice.
+//
+// Providers change a working store during a fetch and publish a copy with
+// each snapshot (see SmartLitterbox::rollups()); a published copy is never
+// changed, so query() on it needs no lock. Pet names live in storage shared
+// by all copies and only ever appended to, so SL_DailyRollup::pet_name stays
+// valid across fetches.
+
+class DailyRollupStore {
+public:
+    DailyRollupStore();
+
+    // 0 (default) keeps every record raw and disables compaction
+    void setRawRetentionDays(int days) { _raw_days = days; }
+    int rawRetentionDays() const { return _raw_days; }
+
+    // Fold raw records that fall before the retention window. Returns the
+    // cutoff; the caller then drops raw records older than it. 0 if disabled.
+    time_t compact(const SL_RecordSource& records, time_t now);
+
+    // Counts one record from before compactedThrough() that was not there when
+    // its day was compacted (a late upload); the caller then drops it. False,
+    // and nothing counted, for records that compaction has yet to reach.
+    bool foldLate(const SL_RecordView& r);
+
+    // Registers the pet names and event types of raw records, so that query()
+    // can summarize them without changing the store. Call before publishing.
+    void addNames(const SL_RecordSource& records);
+
+    // Summaries for [from, to]: stored rollups plus the raw records, which
+    // must have been passed to addNames()
+    void query(const SL_RecordSource& records, time_t from, time_t to, std::vector<SL_DailyRollup>& out) const;
+
+    // Sorted by day, then pet
+    const std::vector<SL_DailyRollup>& entries() const { return _rollups; }
+    time_t compactedThrough() const { return _compacted_through; }
+
+    size_t eventTypeCount() const { return _types.size(); }
+    // The last slot also collects any types beyond SL_ROLLUP_MAX_TYPES
+    const char* eventType(size_t index) const { return index < _types.size() ? _types[index].c_str() : ""; }
+
+    // Bumped by every change, so a provider can tell whether its published
+    // copy is current
+    uint32_t revision() const { return _revision; }
+
+    void clear();
+
+    static uint32_t dayOf(time_t ts);
+    // Local midnight `days` days before the day containing now
+    static time_t dayStart(time_t now, int days);
+
+private:
+    static void _fold(std::vector<SL_DailyRollup>& into, const SL_RecordView& r, const char* pet_name, uint8_t type);
+    const char* _findName(const char* name) const;
+    const char* _addName(const char* name);
+    int _findType(const char* action) const;
+    uint8_t _addType(const char* action);
+
+    int _raw_days;
+    time_t _compacted_through;
+    uint32_t _revision;
+    std::vector<SL_DailyRollup> _rollups;
+    std::shared_ptr<std::deque<String>> _name_storage;  // Shared by all copies; append-only
+    std::vector<const char*> _pet_names;                 // This copy's names, in _name_storage
+    std::vector<String> _types;
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef DeviceStatusTable_h
+#define DeviceStatusTable_h
+
+#include <Arduino.h>
+#include <unordered_map>
+#include <vector>
+
+struct SL_StringHash {
+    size_t operator()(const String& str) const {
+        size_t hash = 5381;
+        for (unsigned int i = 0; i < str.length(); i++) {
+            hash = ((hash << 5) + hash) + str.charAt(i); /* hash * 33 + c */
+        }
+        return hash;
+    }
+};
+
+// Newest status per device, maintained as records are ingested.
+// T needs a `timestamp` member. Entries keep first-seen order.
+template <typename T>
+class DeviceStatusTable {
+public:
+    // O(1): keeps rec if it is at least as new as what we hold for device_id
+    void update(const String& device_id, const T& rec) {
+        auto it = _index.find(device_id);
+        if (it == _index.end()) {
+            _index.emplace(device_id, _entries.size());
+            _entries.push_back(rec);
+        } else if (rec.timestamp >= _entries[it->second].timestamp) {
+            _entries[it->second] = rec;
+        }
+    }
+
+    const T* find(const String& device_id) const {
+        auto it = _index.find(device_id);
+        return it == _index.end() ? nullptr : &_entries[it->second];
+    }
+
+    // Most recent status across all devices
+    const T* newest() const {
+        const T* best = nullptr;
+        for (const auto& e : _entries) {
+            if (!best || e.timestamp > best->timestamp) best = &e;
+        }
+        return best;
+    }
+
+    const std::vector<T>& entries() const { return _entries; }
+    bool empty() const { return _entries.empty(); }
+    size_t size() const { return _entries.size(); }
+
+    void clear() {
+        _entries.clear();
+        _index.clear();
+    }
+
+private:
+    std::vector<T> _entries;
+    std::unordered_map<String, size_t, SL_StringHash> _index;
+};
+
+#endif
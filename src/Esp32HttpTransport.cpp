@@ -0,0 +1,134 @@
+#include "Esp32HttpTransport.h"
+#include "ResumableTlsClient.h"
+#include "InflateStream.h"
+#include "TraceBuffer.h"
+#include <HTTPClient.h>
+#include <WiFi.h>
+
+HttpTransport& defaultHttpTransport()
+{
+    static Esp32HttpTransport instance;
+    return instance;
+}
+
+bool Esp32HttpTransport::isConnected()
+{
+    return WiFi.status() == WL_CONNECTED;
+}
+
+int Esp32HttpTransport::send(const HttpRequest& req, HttpResponse& resp)
+{
+    static const char* collect[] = {"Retry-After", "Content-Encoding"};
+    resp.reset();
+    uint32_t start = millis();
+    bool streamed = (bool)req.body_handler;
+
+    // Declared before http: HTTPClient's destructor still touches its client
+    ResumableTlsClient tls(_cache ? *_cache : TlsSessionCache::shared());
+    HTTPClient http;
+    // Set timeout to prevent blocking indefinitely
+    unsigned long connect_ms = req.connect_timeout_ms ? req.connect_timeout_ms : req.timeout_ms;
+    http.setTimeout(req.timeout_ms);
+    http.setConnectTimeout((int32_t)connect_ms);
+    http.setReuse(false);
+
+    bool began;
+    if (_cache && req.url.startsWith("https://"))
+    {
+        tls.setHandshakeTimeout(connect_ms);
+        began = http.begin(tls, req.url);
+    }
+    else
+    {
+        began = http.begin(req.url);
+    }
+
+    if (!began)
+    {
+        resp.status = HTTPC_ERROR_CONNECTION_REFUSED;
+        resp.error = "begin() failed";
+        return resp.status;
+    }
+    http.collectHeaders(collect, 2);
+    for (int i = 0; i < req.header_count; i++)
+    {
+        http.addHeader(req.headers[i].name, req.headers[i].value);
+    }
+    if (streamed)
+    {
+        // HTTP/1.0 keeps the body free of chunk framing so it can be read raw
+        http.useHTTP10(true);
+        if (_accept_gzip) http.addHeader("Accept-Encoding", "gzip");
+    }
+
+    {
+        // DNS, connect, TLS (traced separately by ResumableTlsClient), server time
+        SL_TRACE_SCOPE_D("connect + wait for headers", "net", req.url.c_str());
+        unsigned long sent = millis();
+        if (req.isPost()) resp.status = http.POST((uint8_t*)req.body, req.body_length);
+        else resp.status = http.GET();
+        resp.header_ms = (long)(millis() - sent);
+    }
+
+    if (resp.status > 0)
+    {
+        resp.retry_after = http.header("Retry-After");
+        if (streamed && resp.status >= 200 && resp.status < 300)
+        {
+            bool gzip = http.header("Content-Encoding").indexOf("gzip") >= 0;
+            WiFiClient& client = http.getStream();
+            InflateStream body(client, gzip, &client, http.getSize());
+            req.body_handler(body);
+            resp.wire_bytes = body.wireBytes();
+            resp.body_bytes = body.inflatedBytes();
+            if (body.failed())
+            {
+                resp.status = HTTPC_ERROR_READ_TIMEOUT;
+                resp.error = "gzip decode failed";
+            }
+        }
+        else
+        {
+            SL_TRACE_SCOPE("download body", "net");
+            resp.body = http.getString();
+            resp.wire_bytes = resp.body_bytes = resp.body.length();
+        }
+    }
+    else
+    {
+        resp.error = HTTPClient::errorToString(resp.status);
+    }
+
+    http.end();
+
+    std::lock_guard<std::mutex> lock(_stats_mutex);
+    _stats.requests++;
+    _stats.wire_bytes += resp.wire_bytes;
+    _stats.body_bytes += resp.body_bytes;
+    _stats.total_ms += millis() - start;
+    return resp.status;
+}
+
+Esp32HttpTransport::Stats Esp32HttpTransport::stats() const
+{
+    std::lock_guard<std::mutex> lock(_stats_mutex);
+    return _stats;
+}
+
+void Esp32HttpTransport::resetStats()
+{
+    std::lock_guard<std::mutex> lock(_stats_mutex);
+    _stats = Stats{};
+}
+
+void Esp32HttpTransport::printStats(Print& out) const
+{
+    Stats s = stats();
+    uint32_t saved = s.body_bytes > s.wire_bytes ? s.body_bytes - s.wire_bytes : 0;
+    char line[128];
+    snprintf(line, sizeof(line), "HTTP: %lu requests, %lu bytes on the wire, %lu decoded (%lu saved), avg %lu ms",
+             (unsigned long)s.requests, (unsigned long)s.wire_bytes,
+             (unsigned long)s.body_bytes, (unsigned long)saved,
+             s.requests ? (unsigned long)(s.total_ms / s.requests) : 0UL);
+    out.println(line);
+}
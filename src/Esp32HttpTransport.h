@@ -0,0 +1,42 @@
+#ifndef Esp32HttpTransport_h
+#define Esp32HttpTransport_h
+
+#include "HttpTransport.h"
+#include "TlsSessionCache.h"
+#include <mutex>
+
+// Transport backed by the ESP32 Arduino HTTPClient, one connection per request.
+// HTTPS connections resume TLS sessions from the given cache (the shared one by
+// default); pass nullptr to use HTTPClient's own WiFiClientSecure instead.
+// Requests with a body_handler ask for gzip and are decoded while streaming.
+// send() may run on several tasks at once (see ThreadedHttpEngine).
+class Esp32HttpTransport : public HttpTransport {
+public:
+    struct Stats {
+        uint32_t requests;
+        uint32_t wire_bytes;
+        uint32_t body_bytes;
+        uint32_t total_ms;
+    };
+
+    Esp32HttpTransport(TlsSessionCache* cache = &TlsSessionCache::shared())
+        : _cache(cache), _accept_gzip(true), _stats{} {}
+
+    void setTlsSessionCache(TlsSessionCache* cache) { _cache = cache; }
+    void setAcceptGzip(bool enabled) { _accept_gzip = enabled; }
+
+    int send(const HttpRequest& req, HttpResponse& resp) override;
+    bool isConnected() override;
+
+    Stats stats() const;
+    void resetStats();
+    void printStats(Print& out) const;
+
+private:
+    TlsSessionCache* _cache;
+    bool _accept_gzip;
+    Stats _stats;
+    mutable std::mutex _stats_mutex;
+};
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef HttpTransport_h
+#define HttpTransport_h
+
+#include <Arduino.h>
+#include <functional>
+
+// Seam between the providers and the network. PetKitApi / WhiskerApi build an
+// HttpRequest and hand it to whatever transport they were given, which lets
+// traffic be recorded, replayed, or shaped without touching provider code.
+
+#define SL_HTTP_MAX_HEADERS 8
+
+struct HttpRequest {
+    const char* method = "GET";
+    String url;
+    const uint8_t* body = nullptr;  // Not owned; must outlive send()
+    size_t body_length = 0;
+    unsigned long timeout_ms = 10000;       // Longest wait for the headers or between body reads
+    unsigned long connect_timeout_ms = 0;   // 0: same as timeout_ms
+    bool idempotent = false;                // Safe to send twice (hedging)
+    uint8_t size_class = 0;                 // Expected response size, for latency
+                                            // estimates (RequestScheduler::sizeClass)
+
+    struct Header {
+        const char* name;
+        String value;
+    };
+    Header headers[SL_HTTP_MAX_HEADERS];
+    int header_count = 0;
+
+    // When set, a 2xx body is handed to this callback as a Stream (already
+    // decompressed) instead of being buffered into HttpResponse::body. Such
+    // requests may be sent with Accept-Encoding: gzip.
+    std::function<void(Stream& body)> body_handler;
+
+    void addHeader(const char* name, const String& value) {
+        if (header_count < SL_HTTP_MAX_HEADERS) headers[header_count++] = Header{name, value};
+    }
+    // Replace the value of an existing header, or add it
+    void setHeader(const char* name, const String& value) {
+        for (int i = 0; i < header_count; i++) {
+            if (strcmp(headers[i].name, name) == 0) {
+                headers[i].value = value;
+                return;
+            }
+        }
+        addHeader(name, value);
+    }
+    bool isPost() const { return strcmp(method, "POST") == 0; }
+};
+
+struct HttpResponse {
+    int status = 0;         // HTTP status, or <= 0 for a transport error
+    String body;
+    String retry_after;     // Raw Retry-After header, empty if absent
+    String error;           // Set when status <= 0
+    size_t wire_bytes = 0;  // Body bytes received (compressed size if gzip)
+    size_t body_bytes = 0;  // Body bytes after decoding
+    long header_ms = -1;    // Send to response headers; -1 if not measured
+
+    void reset() {
+        status = 0;
+        body = "";
+        retry_after = "";
+        error = "";
+        wire_bytes = 0;
+        body_bytes = 0;
+        header_ms = -1;
+    }
+};
+
+// Stream over a buffer in memory, for transports that already hold the body
+class MemoryStream : public Stream {
+public:
+    MemoryStream(const char* data, size_t length) : _data(data), _length(length), _pos(0) {}
+
+    int available() override { return (int)(_length - _pos); }
+    int read() override { return _pos < _length ? (uint8_t)_data[_pos++] : -1; }
+    int peek() override { return _pos < _length ? (uint8_t)_data[_pos] : -1; }
+    size_t write(uint8_t) override { return 0; }
+
+private:
+    const char* _data;
+    size_t _length;
+    size_t _pos;
+};
+
+// For buffering transports: pass a 2xx body to req.body_handler, if any
+inline void deliverBody(const HttpRequest& req, HttpResponse& resp) {
+    if (!req.body_handler || resp.status < 200 || resp.status > 299) return;
+    MemoryStream stream(resp.body.c_str(), resp.body.length());
+    req.body_handler(stream);
+    resp.body = "";
+}
+
+// Completion for submit(); resp is only valid during the call
+typedef std::function<void(HttpResponse& resp)> HttpCompletion;
+
+class HttpTransport {
+public:
+    virtual ~HttpTransport() {}
+
+    // Perform one exchange. Fills resp and returns resp.status.
+    virtual int send(const HttpRequest& req, HttpResponse& resp) = 0;
+
+    // Start an exchange and call done when it finishes. Asynchronous engines
+    // return at once and run done (and req.body_handler) on their own thread;
+    // req is copied, but req.body must stay valid until done runs. The
+    // default completes inline, so every transport can be used this way.
+    virtual void submit(const HttpRequest& req, HttpCompletion done) {
+        HttpResponse resp;
+        send(req, resp);
+        done(resp);
+    }
+
+    // False when the link is known to be down (e.g. WiFi disconnected)
+    virtual bool isConnected() { return true; }
+};
+
+// Platform transport used when a provider is not given one explicitly
+HttpTransport& defaultHttpTransport();
+
+#endif
@@ -0,0 +1,239 @@
+#include "InflateStream.h"
+#include <mutex>
+#include <vector>
+
+// gzip header flags (RFC 1952)
+#define GZ_FHCRC    0x02
+#define GZ_FEXTRA   0x04
+#define GZ_FNAME    0x08
+#define GZ_FCOMMENT 0x10
+
+struct InflateStream::Scratch
+{
+    uint8_t window[SL_INFLATE_WINDOW];
+#if defined(SL_INFLATE_TINFL)
+    tinfl_decompressor tinfl;
+#endif
+};
+
+static std::mutex spare_mutex;
+static std::vector<void*> spare;
+
+InflateStream::InflateStream(Stream& source, bool gzip, Client* client, long length)
+    : _source(source),
+      _client(client),
+      _remaining(length),
+      _gzip(gzip),
+      _started(false),
+      _done(false),
+      _failed(false),
+      _source_eof(false),
+      _in_pos(0),
+      _in_len(0),
+      _scratch(nullptr),
+      _rd(0),
+      _wr(0),
+      _wire_bytes(0),
+      _out_bytes(0)
+{
+#if !defined(SL_INFLATE_TINFL)
+    memset(&_z, 0, sizeof(_z));
+#endif
+}
+
+InflateStream::~InflateStream()
+{
+#if !defined(SL_INFLATE_TINFL)
+    if (_started && _gzip) inflateEnd(&_z);
+#endif
+    if (!_scratch) return;
+    std::lock_guard<std::mutex> lock(spare_mutex);
+    if (spare.size() < SL_INFLATE_SPARE) spare.push_back(_scratch);
+    else free(_scratch);
+}
+
+void InflateStream::releaseSpare()
+{
+    std::lock_guard<std::mutex> lock(spare_mutex);
+    for (void* s : spare) free(s);
+    spare.clear();
+}
+
+int InflateStream::available()
+{
+    if (!_gzip)
+    {
+        if (_in_pos == _in_len) _refillInput();
+        return (int)(_in_len - _in_pos);
+    }
+    if (_rd == _wr) _fill();
+    return (int)(_wr - _rd);
+}
+
+int InflateStream::read()
+{
+    if (!_gzip)
+    {
+        if (_in_pos == _in_len && !_refillInput()) return -1;
+        _out_bytes++;
+        return _in[_in_pos++];
+    }
+    if (_rd == _wr && !_fill()) return -1;
+    return _scratch->window[_rd++ % SL_INFLATE_WINDOW];
+}
+
+int InflateStream::peek()
+{
+    if (!_gzip)
+    {
+        if (_in_pos == _in_len && !_refillInput()) return -1;
+        return _in[_in_pos];
+    }
+    if (_rd == _wr && !_fill()) return -1;
+    return _scratch->window[_rd % SL_INFLATE_WINDOW];
+}
+
+// --- Private Helper Methods ---
+
+bool InflateStream::_refillInput()
+{
+    if (_source_eof) return false;
+
+    unsigned long start = millis();
+    while (true)
+    {
+        int avail = _source.available();
+        if (avail > 0)
+        {
+            size_t want = (size_t)avail < sizeof(_in) ? (size_t)avail : sizeof(_in);
+            if (_remaining >= 0 && (long)want > _remaining) want = _remaining;
+            _in_len = _source.readBytes((char*)_in, want);
+            _in_pos = 0;
+            _wire_bytes += _in_len;
+            if (_remaining >= 0) _remaining -= _in_len;
+            return _in_len > 0;
+        }
+        // End of body: length reached, connection closed, or an in-memory source ran dry
+        if (_remaining == 0 || !_client || !_client->connected()) break;
+        if (millis() - start > _source.getTimeout())
+        {
+            _failed = true;
+            break;
+        }
+        delay(1);
+    }
+    _source_eof = true;
+    return false;
+}
+
+int InflateStream::_readSourceByte()
+{
+    if (_in_pos == _in_len && !_refillInput()) return -1;
+    return _in[_in_pos++];
+}
+
+bool InflateStream::_skipGzipHeader()
+{
+    uint8_t header[10];
+    for (int i = 0; i < 10; i++)
+    {
+        int c = _readSourceByte();
+        if (c < 0) return false;
+        header[i] = c;
+    }
+    if (header[0] != 0x1f || header[1] != 0x8b || header[2] != 8) return false;
+
+    uint8_t flags = header[3];
+    if (flags & GZ_FEXTRA)
+    {
+        int lo = _readSourceByte();
+        int hi = _readSourceByte();
+        if (lo < 0 || hi < 0) return false;
+        for (int n = lo | (hi << 8); n > 0; n--)
+        {
+            if (_readSourceByte() < 0) return false;
+        }
+    }
+    if (flags & GZ_FNAME)
+    {
+        int c;
+        while ((c = _readSourceByte()) > 0) {}
+        if (c < 0) return false;
+    }
+    if (flags & GZ_FCOMMENT)
+    {
+        int c;
+        while ((c = _readSourceByte()) > 0) {}
+        if (c < 0) return false;
+    }
+    if (flags & GZ_FHCRC)
+    {
+        if (_readSourceByte() < 0 || _readSourceByte() < 0) return false;
+    }
+    return true;
+}
+
+bool InflateStream::_fill()
+{
+    if (_done) return false;
+
+    if (!_started)
+    {
+        _started = true;
+        {
+            std::lock_guard<std::mutex> lock(spare_mutex);
+            if (!spare.empty())
+            {
+                _scratch = (Scratch*)spare.back();
+                spare.pop_back();
+            }
+        }
+        if (!_scratch) _scratch = (Scratch*)malloc(sizeof(Scratch));
+#if defined(SL_INFLATE_TINFL)
+        if (!_scratch || !_skipGzipHeader())
+        {
+            _failed = _done = true;
+            return false;
+        }
+        tinfl_init(&_scratch->tinfl);
+#else
+        // 16 + MAX_WBITS: zlib parses the gzip wrapper itself
+        if (!_scratch || inflateInit2(&_z, 16 + MAX_WBITS) != Z_OK)
+        {
+            _failed = _done = true;
+            return false;
+        }
+#endif
+    }
+
+    while (_rd == _wr && !_done)
+    {
+        if (_in_pos == _in_len) _refillInput();
+        size_t in_bytes = _in_len - _in_pos;
+        size_t out_ofs = _wr % SL_INFLATE_WINDOW;
+        size_t out_bytes = SL_INFLATE_WINDOW - out_ofs;
+
+#if defined(SL_INFLATE_TINFL)
+        uint8_t* window = _scratch->window;
+        tinfl_status status = tinfl_decompress(&_scratch->tinfl, _in + _in_pos, &in_bytes,
+                                               window, window + out_ofs, &out_bytes,
+                                               _source_eof ? 0 : TINFL_FLAG_HAS_MORE_INPUT);
+        if (status == TINFL_STATUS_DONE) _done = true;
+        else if (status < 0 || (status == TINFL_STATUS_NEEDS_MORE_INPUT && _source_eof)) _failed = _done = true;
+#else
+        _z.next_in = _in + _in_pos;
+        _z.avail_in = in_bytes;
+        _z.next_out = _scratch->window + out_ofs;
+        _z.avail_out = out_bytes;
+        int ret = inflate(&_z, Z_NO_FLUSH);
+        in_bytes -= _z.avail_in;
+        out_bytes -= _z.avail_out;
+        if (ret == Z_STREAM_END) _done = true;
+        else if ((ret != Z_OK && ret != Z_BUF_ERROR) || (out_bytes == 0 && in_bytes == 0 && _source_eof)) _failed = _done = true;
+#endif
+        _in_pos += in_bytes;
+        _wr += out_bytes;
+        _out_bytes += out_bytes;
+    }
+    return _rd != _wr;
+}
@@ -0,0 +1,83 @@
+#ifndef InflateStream_h
+#define InflateStream_h
+
+#include <Arduino.h>
+#include <Client.h>
+
+#if defined(ESP32)
+#if __has_include("esp32/rom/miniz.h")
+#include "esp32/rom/miniz.h"
+#else
+#include "rom/miniz.h"
+#endif
+#define SL_INFLATE_TINFL 1
+#define SL_INFLATE_WINDOW TINFL_LZ_DICT_SIZE
+#else
+#include <zlib.h>
+#define SL_INFLATE_WINDOW 4096
+#endif
+
+#ifndef SL_INFLATE_SPARE
+#define SL_INFLATE_SPARE 2      // Idle windows kept for reuse (one per concurrent stream)
+#endif
+
+// Read-only Stream that decodes a gzip body on the fly, so deserializeJson()
+// can parse a compressed response without the inflated text ever being held
+// in full. On ESP32 it uses the ROM tinfl, which needs the whole 32 KB deflate
+// window (gzip does not say how far back the server refers). Hosts use zlib
+// with a small output window. Windows are pooled: a finished stream hands
+// its window on to the next one instead of freeing it. With gzip = false it
+// passes bytes through unchanged, so the byte counters work for both modes.
+
+class InflateStream : public Stream {
+public:
+    // client (optional) lets end-of-body be detected by connection close;
+    // length is the Content-Length on the wire, or -1 if unknown
+    InflateStream(Stream& source, bool gzip, Client* client = nullptr, long length = -1);
+    ~InflateStream();
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t) override { return 0; }
+
+    // Frees the pooled windows, e.g. before a memory-hungry phase
+    static void releaseSpare();
+
+    bool failed() const { return _failed; }
+    size_t wireBytes() const { return _wire_bytes; }
+    size_t inflatedBytes() const { return _out_bytes; }
+
+private:
+    bool _fill();
+    bool _refillInput();
+    bool _skipGzipHeader();
+    int _readSourceByte();
+
+    Stream& _source;
+    Client* _client;
+    long _remaining;
+    bool _gzip;
+    bool _started;
+    bool _done;
+    bool _failed;
+    bool _source_eof;
+
+    uint8_t _in[512];
+    size_t _in_pos;
+    size_t _in_len;
+
+    struct Scratch;
+    Scratch* _scratch;  // Window (and decompressor), taken from the pool
+    size_t _rd;     // Read / write positions in the (ring) window
+    size_t _wr;
+
+    size_t _wire_bytes;
+    size_t _out_bytes;
+
+#if !defined(SL_INFLATE_TINFL)
+    z_stream _z;
+#endif
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef JsonSchema_h
+#define JsonSchema_h
+
+#include <ArduinoJson.h>
+#include <string.h>
+
+// Field access for JSON objects of a known shape. A parser lists the keys it
+// reads as a table of SL_Key, whose hashes are computed at compile time, and
+// SL_Fields walks an object's members once, filing each wanted value under
+// its table index. That replaces one member scan with string compares per
+// obj["key"] lookup; members the parser does not want cost a hash and a few
+// integer compares.
+//
+// The same tables map string codes from the cloud (activity values, robot
+// states) to enums: the code's index in the table is its enum value.
+
+// FNV-1a; a single-return recursion so it stays a C++11 constant expression
+constexpr uint32_t sl_keyHash(const char* s, uint32_t h = 2166136261u) {
+    return *s ? sl_keyHash(s + 1, (h ^ (uint8_t)*s) * 16777619u) : h;
+}
+
+// Same hash for a key that is not NUL-terminated, at run time
+inline uint32_t sl_keyHash(const char* s, size_t len, uint32_t h) {
+    for (size_t i = 0; i < len; i++) h = (h ^ (uint8_t)s[i]) * 16777619u;
+    return h;
+}
+
+constexpr size_t sl_keyLength(const char* s, size_t n = 0) {
+    return *s ? sl_keyLength(s + 1, n + 1) : n;
+}
+
+struct SL_Key {
+    const char* name;
+    size_t length;
+    uint32_t hash;
+};
+
+#define SL_KEY(name) SL_Key{name, sl_keyLength(name), sl_keyHash(name)}
+
+// Index of `key` in `keys`, or -1
+inline int sl_findKey(const SL_Key* keys, size_t count, const char* key, size_t len) {
+    if (!key) return -1;
+    uint32_t h = sl_keyHash(key, len, 2166136261u);
+    for (size_t i = 0; i < count; i++) {
+        if (keys[i].hash == h && keys[i].length == len && memcmp(keys[i].name, key, len) == 0) return (int)i;
+    }
+    return -1;
+}
+
+template <size_t N>
+inline int sl_findKey(const SL_Key (&keys)[N], const char* key) {
+    return key ? sl_findKey(keys, N, key, strlen(key)) : -1;
+}
+
+template <size_t N>
+inline int sl_findKey(const SL_Key (&keys)[N], JsonString key) {
+    return sl_findKey(keys, N, key.c_str(), key.size());
+}
+
+// Values of the keys in `keys` (null where absent), resolved in one pass
+template <size_t N>
+class SL_Fields {
+public:
+    SL_Fields(JsonObjectConst obj, const SL_Key (&keys)[N]) {
+        for (JsonPairConst kv : obj) {
+            int i = sl_findKey(keys, N, kv.key().c_str(), kv.key().size());
+            if (i >= 0) _values[i] = kv.value();
+        }
+    }
+
+    JsonVariantConst operator[](size_t i) const { return _values[i]; }
+
+private:
+    JsonVariantConst _values[N];
+};
+
+#endif
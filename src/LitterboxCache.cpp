@@ -0,0 +1,217 @@
+#include "LitterboxCache.h"
+
+#if defined(ESP32)
+#include "esp_pthread.h"
+#endif
+
+LitterboxCache::LitterboxCache(SmartLitterbox& box, int fetch_param, size_t stack_size)
+    : _box(box),
+      _fetch_param(fetch_param),
+      _stack_size(stack_size),
+      _stale_while_revalidate(true),
+      _in_flight(false),
+      _revalidate_due(false),
+      _closed(false),
+      _generation(0),
+      _fetch_count(0)
+{
+    // Defaults: pets rarely change, status is what dashboards poll
+    _ttl_ms[(int)SL_DataClass::PETS] = 24UL * 60 * 60 * 1000;
+    _ttl_ms[(int)SL_DataClass::RECORDS] = 15UL * 60 * 1000;
+    _ttl_ms[(int)SL_DataClass::STATUS] = 60UL * 1000;
+
+    // The TTLs decide what is fetched; the provider fetches what we invalidate
+    for (int i = 0; i < SL_DATA_CLASS_COUNT; i++)
+    {
+        _expired[i] = false;
+        _box.cadence().setInterval((SL_DataClass)i, SL_CADENCE_ON_DEMAND);
+    }
+}
+
+LitterboxCache::~LitterboxCache()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _closed = true;
+    }
+    _wake.notify_all();
+    // Waits for a running revalidation
+    if (_revalidator.joinable()) _revalidator.join();
+}
+
+void LitterboxCache::setTtl(SL_DataClass cls, unsigned long ttl_ms)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _ttl_ms[(int)cls] = ttl_ms;
+}
+
+void LitterboxCache::setStaleWhileRevalidate(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stale_while_revalidate = enabled;
+}
+
+void LitterboxCache::invalidate(SL_DataClass cls)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    // Keep the data for stale readers but treat it as expired
+    _expired[(int)cls] = true;
+}
+
+void LitterboxCache::invalidate()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (int i = 0; i < SL_DATA_CLASS_COUNT; i++) _expired[i] = true;
+}
+
+std::vector<SL_Record> LitterboxCache::getRecords()
+{
+    std::shared_ptr<const Snapshot> snap = snapshot(SL_DataClass::RECORDS);
+    std::vector<SL_Record> out;
+    out.reserve(snap->records->recordCount());
+    for (const SL_RecordView& r : SL_RecordRange(*snap->records))
+    {
+        SL_Record rec;
+        rec.pet_name = r.pet_name;
+        rec.PetId = r.PetId;
+        rec.timestamp = r.timestamp;
+        rec.weight_lbs = r.weight_lbs;
+        rec.duration_seconds = r.duration_seconds;
+        rec.action = r.action;
+        rec.source_device = r.source_device;
+        out.push_back(rec);
+    }
+    return out;
+}
+
+std::shared_ptr<const LitterboxCache::Snapshot> LitterboxCache::snapshot(SL_DataClass cls)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    while (!_isFresh(cls, millis()))
+    {
+        if (!_in_flight)
+        {
+            _in_flight = true;
+            if (_stale_while_revalidate && _hasData(cls))
+            {
+                // Serve what we have; the revalidation task fetches meanwhile
+                _revalidate();
+                break;
+            }
+            // Nothing to serve: we become the single flight, everybody else waits
+            _refresh(lock);
+            break;
+        }
+        if (_stale_while_revalidate && _hasData(cls)) break;
+
+        unsigned long seen = _generation;
+        _done.wait(lock, [&] { return _generation != seen; });
+        break; // Take whatever that fetch produced, even if it failed
+    }
+
+    if (!_snapshot)
+    {
+        // Never fetched successfully; hand out an empty snapshot
+        auto empty = std::make_shared<Snapshot>();
+        empty->records = _box.recordSource();
+        empty->status = SL_Status{ApiType::PETKIT, "", "", 0, 0, 0, false, false, "Unknown"};
+        return empty;
+    }
+    return _snapshot;
+}
+
+// --- Private Helper Methods ---
+
+bool LitterboxCache::_isFresh(SL_DataClass cls, unsigned long now) const
+{
+    int i = (int)cls;
+    if (!_hasData(cls) || _expired[i]) return false;
+    return (now - _snapshot->fetched_at[i]) < _ttl_ms[i];
+}
+
+bool LitterboxCache::_hasData(SL_DataClass cls) const
+{
+    return _snapshot && _snapshot->fetched[(int)cls];
+}
+
+// Runs one fetch with the lock released; _in_flight is already set
+void LitterboxCache::_refresh(std::unique_lock<std::mutex>& lock)
+{
+    // This fetch serves pending invalidations; one that arrives meanwhile stays
+    bool stale[SL_DATA_CLASS_COUNT];
+    unsigned long now = millis();
+    for (int i = 0; i < SL_DATA_CLASS_COUNT; i++)
+    {
+        stale[i] = !_isFresh((SL_DataClass)i, now);
+        if (stale[i]) _expired[i] = false;
+    }
+    std::shared_ptr<const Snapshot> prev = _snapshot;
+    lock.unlock();
+
+    // Only this thread touches the provider, so its vectors are stable here
+    for (int i = 0; i < SL_DATA_CLASS_COUNT; i++)
+        if (stale[i]) _box.invalidate((SL_DataClass)i);
+
+    std::shared_ptr<Snapshot> next;
+    bool refreshed[SL_DATA_CLASS_COUNT] = {false, false, false};
+    if (_box.fetchAllData(_fetch_param))
+    {
+        next = prev ? std::make_shared<Snapshot>(*prev) : std::make_shared<Snapshot>();
+        // The provider publishes complete passes only, so these are consistent
+        next->pets = _box.getUnifiedPets();
+        next->records = _box.recordSource();
+        next->status = _box.getUnifiedStatus();
+        next->statuses = _box.getUnifiedStatuses();
+
+        // A class the provider marked done was fetched; a failed one is still due
+        unsigned long at = millis();
+        time_t wall = time(nullptr);
+        for (int i = 0; i < SL_DATA_CLASS_COUNT; i++)
+        {
+            if (!stale[i] || _box.cadence().due((SL_DataClass)i, wall)) continue;
+            refreshed[i] = true;
+            next->fetched_at[i] = at;
+            next->fetched[i] = true;
+        }
+    }
+
+    lock.lock();
+    if (next) _snapshot = next;
+    for (int i = 0; i < SL_DATA_CLASS_COUNT; i++)
+        if (stale[i] && !refreshed[i]) _expired[i] = true;
+    _fetch_count++;
+    _in_flight = false;
+    _generation++;
+    _done.notify_all();
+}
+
+// Called with the lock held
+void LitterboxCache::_revalidate()
+{
+    _revalidate_due = true;
+    if (!_revalidator.joinable())
+    {
+#if defined(ESP32)
+        // std::thread is a pthread on a FreeRTOS task; the default stack is too small for TLS
+        esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+        cfg.stack_size = _stack_size;
+        cfg.thread_name = "sl_cache";
+        esp_pthread_set_cfg(&cfg);
+#endif
+        _revalidator = std::thread([this] { _revalidateLoop(); });
+    }
+    _wake.notify_one();
+}
+
+void LitterboxCache::_revalidateLoop()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (;;)
+    {
+        _wake.wait(lock, [this] { return _revalidate_due || _closed; });
+        if (_closed) break;
+        _revalidate_due = false;
+        _refresh(lock);
+    }
+}
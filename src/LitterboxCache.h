@@ -0,0 +1,90 @@
+#ifndef LitterboxCache_h
+#define LitterboxCache_h
+
+#include <Arduino.h>
+#include "SmartLitterbox.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Caching front over a SmartLitterbox for gateways with several consumer tasks.
+// Every read goes through the cache, and one fetchAllData() at a time
+// refreshes it (single-flight), so cloud traffic depends on the TTLs only, not
+// on the number of consumers. A refresh fetches only the classes that are past
+// their TTL: the cache sets every class of the provider's cadence() to
+// SL_CADENCE_ON_DEMAND and invalidates the stale ones before the fetch. A class
+// the provider still reports due afterwards failed and stays stale. When the
+// requested data class is older than its TTL:
+//  - with stale-while-revalidate (default), every caller gets the previous
+//    snapshot at once and the fetch runs on the cache's own task;
+//  - without it, or before the first successful fetch, one caller runs the
+//    fetch and the others wait for it.
+//
+// Consumers must not call fetchAllData() on the wrapped provider themselves,
+// nor change its cadence.
+
+class LitterboxCache {
+public:
+    // Immutable copy of the provider's unified data taken after a fetch;
+    // records share the provider's published snapshot instead of a copy
+    struct Snapshot {
+        std::vector<SL_Pet> pets;
+        std::shared_ptr<const SL_RecordSource> records;
+        SL_Status status;
+        std::vector<SL_Status> statuses;
+        unsigned long fetched_at[SL_DATA_CLASS_COUNT] = {0, 0, 0};     // millis()
+        bool fetched[SL_DATA_CLASS_COUNT] = {false, false, false};
+    };
+
+    // stack_size: the revalidation task's, which runs the provider's requests
+    LitterboxCache(SmartLitterbox& box, int fetch_param = 10, size_t stack_size = 12288);
+    ~LitterboxCache();
+
+    void setTtl(SL_DataClass cls, unsigned long ttl_ms);
+    void setStaleWhileRevalidate(bool enabled);
+
+    std::shared_ptr<const Snapshot> snapshot(SL_DataClass cls);
+
+    std::vector<SL_Pet> getPets() { return snapshot(SL_DataClass::PETS)->pets; }
+    std::vector<SL_Record> getRecords();
+    // Allocation-free iteration; holds the snapshot for as long as the range lives
+    SL_RecordRange records() { return SL_RecordRange(snapshot(SL_DataClass::RECORDS)->records); }
+    SL_Status getStatus() { return snapshot(SL_DataClass::STATUS)->status; }
+    std::vector<SL_Status> getStatuses() { return snapshot(SL_DataClass::STATUS)->statuses; }
+
+    // Force the next read of one class, or of every class, to refresh
+    void invalidate(SL_DataClass cls);
+    void invalidate();
+
+    unsigned long fetchCount() const { return _fetch_count; }
+
+private:
+    bool _isFresh(SL_DataClass cls, unsigned long now) const;
+    bool _hasData(SL_DataClass cls) const;
+    void _refresh(std::unique_lock<std::mutex>& lock);
+    void _revalidate();
+    void _revalidateLoop();
+
+    SmartLitterbox& _box;
+    int _fetch_param;
+    size_t _stack_size;
+    unsigned long _ttl_ms[SL_DATA_CLASS_COUNT];
+    bool _stale_while_revalidate;
+
+    std::mutex _mutex;
+    std::condition_variable _done;
+    std::condition_variable _wake;      // Revalidation task
+    bool _expired[SL_DATA_CLASS_COUNT];
+    bool _in_flight;
+    bool _revalidate_due;
+    bool _closed;
+    unsigned long _generation;
+    std::atomic<unsigned long> _fetch_count;
+    std::shared_ptr<const Snapshot> _snapshot;
+    std::thread _revalidator;           // Started by the first stale read
+};
+
+#endif
@@ -1,6 +1,7 @@
 #include "PetKitApi.h"
+#include "TraceBuffer.h"
+#include "JsonSchema.h"
 #include "mbedtls/md5.h"
-#include <WiFi.h>
 #include <algorithm> 
 
 String md5(String str)
@@ -23,15 +24,21 @@ String md5(String str)
 }
 
 PetKitApi::PetKitApi(const char *username, const char *password, const char *region, const char *timezone, int led)
-    : _username(username),
+    : _ledpin(led),
+      _log_level(SL_LOG_LEVEL_NONE),
+      _username(username),
       _password(password),
       _region(region),
       _timezone(timezone),
-      _ledpin(led),
-      _debug(false) 
+      _scheduler(&RequestScheduler::shared()),
+      _transport(&defaultHttpTransport()),
+      _max_in_flight(SL_MAX_IN_FLIGHT),
+      _keep_status_history(false)
 {
+    _retries_left = _scheduler->retryBudget();
     _base_url = "https://passport.petkt.com";
     if (_ledpin > 0) pinMode(_ledpin, OUTPUT);
+    _publish(true, true, true); // Empty, so readers never see a null part
 }
 
 PetKitApi::~PetKitApi()
@@ -39,29 +46,41 @@ PetKitApi::~PetKitApi()
     
 }
 
-void PetKitApi::_log(const char *message) {
-    if (_debug && Serial) Serial.println(message);
+void PetKitApi::_logf(uint8_t level, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    sl_vlog(level, nullptr, fmt, args);
+    va_end(args);
 }
 
-void PetKitApi::_log(const String &message) {
-    if (_debug && Serial) Serial.println(message);
+void PetKitApi::setDebug(bool enabled) {
+    _log_level = enabled ? SL_LOG_LEVEL_DEBUG : SL_LOG_LEVEL_NONE;
 }
 
-void PetKitApi::setDebug(bool enabled) {
-    _debug = enabled;
+void PetKitApi::setLogLevel(uint8_t level) {
+    _log_level = level;
+}
+
+void PetKitApi::setScheduler(RequestScheduler &scheduler) {
+    _scheduler = &scheduler;
+}
+
+void PetKitApi::setTransport(HttpTransport &transport) {
+    _transport = &transport;
 }
 
 bool PetKitApi::login()
 {
-    if (WiFi.status() != WL_CONNECTED)
+    SL_TRACE_SCOPE("PetKit login", "auth");
+    if (!_transport->isConnected())
     {
-        _log("Error: WiFi not connected. Cannot log in.");
+        SL_LOGE("Error: WiFi not connected. Cannot log in.");
         return false;
     }
     // Safety check: Time MUST be synced for PetKit signatures to work
     if (time(nullptr) < 1000000) // Rough check for valid epoch
     {
-        _log("Error: System time invalid. Ensure NTP is synced.");
+        SL_LOGE("Error: System time invalid. Ensure NTP is synced.");
         return false;
     }
 
@@ -69,7 +88,7 @@ bool PetKitApi::login()
     
     if (_ledpin > 0) digitalWrite(_ledpin, !digitalRead(_ledpin));
 
-    _log("Attempting to log in...");
+    SL_LOGI("Attempting to log in...");
     JsonDocument client_nfo;
     client_nfo["locale"] = "en-US";
     client_nfo["name"] = "23127PN0CG";
@@ -80,21 +99,25 @@ bool PetKitApi::login()
     client_nfo["timezoneId"] = _timezone;
     client_nfo["timezone"] = _getTimezoneOffset();
     
-    String client_nfo_str;
-    serializeJson(client_nfo, client_nfo_str);
-
-    String payload = "oldVersion=12.4.1";
-    payload += "&client=" + _urlEncode(client_nfo_str);
-    payload += "&encrypt=1";
-    payload += "&region=" + _region;
-    payload += "&username=" + _urlEncode(_username);
-    payload += "&password=" + md5(_password);
+    // Not _form: login can run from inside a request that is still using it
+    FormBuilder form;
+    form.add("oldVersion", "12.4.1");
+    form.addJson("client", client_nfo);
+    form.add("encrypt", "1");
+    form.add("region", _region);
+    form.add("username", _username);
+    form.add("password", md5(_password));
+    if (form.overflowed())
+    {
+        SL_LOGE("Login payload too large.");
+        return false;
+    }
 
-    String response = _sendRequest("/user/login", payload, true, true);
+    String response = _sendRequest("/user/login", form.c_str(), form.length(), true, true);
 
     if (response == "")
     {
-        _log("Login request failed.");
+        SL_LOGE("Login request failed.");
         return false;
     }
     
@@ -105,46 +128,98 @@ bool PetKitApi::login()
 
     if (error)
     {
-        _log(String("Login JSON parsing failed: ") + error.c_str());
+        SL_LOGE("Login JSON parsing failed: %s", error.c_str());
         return false;
     }
 
     if (result["session"])
     {
         _session_id = result["session"]["id"].as<String>();
-        _log("Login successful!");
+        SL_LOGI("Login successful!");
         return true;
     }
     else
     {
-        _log("Login failed.");
+        SL_LOGE("Login failed.");
         return false;
     }
 }
 
 bool PetKitApi::fetchAllData(int days_back)
 {
+    SL_TRACE_SCOPE("PetKit sync", "sync");
     if (_session_id == "")
     {
-        _log("Not logged in. Attempting login...");
+        SL_LOGI("Not logged in. Attempting login...");
         if (!login()) return false;
     }
-    _getDevices();
-    _parsePets();
-    _getLitterboxData(days_back);
+    _retries_left = _scheduler->retryBudget();
+    time_t now = time(nullptr);
+
+    // Pets and devices come from the same family list
+    bool pets_fetched = false;
+    if (_cadence.due(SL_DataClass::PETS, now) || _device_list.isNull())
+    {
+        pets_fetched = _getDevices();
+        if (pets_fetched)
+        {
+            _parsePets();
+            _cadence.markDone(SL_DataClass::PETS, now);
+        }
+    }
+
+    // PetKit status comes from the newest records, so a status-only pass
+    // reads just today without disturbing the stored history window
+    bool records_due = _cadence.due(SL_DataClass::RECORDS, now);
+    bool status_due = _cadence.due(SL_DataClass::STATUS, now);
+    bool records_fetched = false;
+    bool status_fetched = false;
+    if (records_due)
+    {
+        records_fetched = status_fetched = _getLitterboxData(days_back, false);
+        if (records_fetched)
+        {
+            // Only complete days are folded: compaction never revisits a day
+            _compactRecords();
+            _cadence.markDone(SL_DataClass::RECORDS, now);
+            _cadence.markDone(SL_DataClass::STATUS, now);
+        }
+    }
+    else if (status_due)
+    {
+        status_fetched = _getLitterboxData(1, true);
+        if (status_fetched) _cadence.markDone(SL_DataClass::STATUS, now);
+    }
+
+    if (status_fetched)
+    {
+        _detectChanges();
+    }
+    else if (records_due || status_due)
+    {
+        // A pass that failed part-way leaves partial working state. Readers
+        // keep the published parts and the next pass starts from them.
+        _litterbox_records.clear();
+        _status_records.clear();
+        _status_table = *_published.load()->statuses;
+    }
+
+    // Readers switch to this fetch's data in one step
+    _publish(pets_fetched, records_fetched, status_fetched);
     return true;
 }
 
 // --- Data Accessors ---
 
-const std::vector<Pet> &PetKitApi::getPets() const { return _pets; }
-const std::vector<LitterboxRecord> &PetKitApi::getLitterboxRecords() const { return _litterbox_records; }
-const std::vector<StatusRecord> &PetKitApi::getStatusRecords() const { return _status_records; }
+std::vector<Pet> PetKitApi::getPets() const { return *snapshot()->pets; }
+std::vector<LitterboxRecord> PetKitApi::getLitterboxRecords() const { return *snapshot()->records; }
+std::vector<StatusRecord> PetKitApi::getStatusRecords() const { return *snapshot()->status_history; }
 
 std::vector<LitterboxRecord> PetKitApi::getLitterboxRecordsByPetId(int pet_id) const
 {
+    std::shared_ptr<const Snapshot> snap = snapshot();
     std::vector<LitterboxRecord> pet_records;
-    for (const auto &record : _litterbox_records)
+    for (const auto &record : *snap->records)
     {
         if (record.pet_id == pet_id) pet_records.push_back(record);
     }
@@ -153,8 +228,21 @@ std::vector<LitterboxRecord> PetKitApi::getLitterboxRecordsByPetId(int pet_id) c
 
 StatusRecord PetKitApi::getLatestStatus() const
 {
-    if (_status_records.empty()) return StatusRecord{}; 
-    return _status_records.front();
+    std::shared_ptr<const Snapshot> snap = snapshot();
+    const StatusRecord *r = snap->statuses->newest();
+    return r ? *r : StatusRecord{};
+}
+
+StatusRecord PetKitApi::getLatestStatus(const String &device_id) const
+{
+    std::shared_ptr<const Snapshot> snap = snapshot();
+    const StatusRecord *r = snap->statuses->find(device_id);
+    return r ? *r : StatusRecord{};
+}
+
+void PetKitApi::setKeepStatusHistory(bool enabled)
+{
+    _keep_status_history = enabled;
 }
 
 // --- Private Helper Methods ---
@@ -179,7 +267,8 @@ String PetKitApi::_getTimezoneOffset()
 
 bool PetKitApi::_getBaseUrl()
 {
-    _log("Getting regional server URL...");
+    SL_TRACE_SCOPE("getBaseUrl", "auth");
+    SL_LOGD("Getting regional server URL...");
     String response = _sendRequest("/v1/regionservers", "", false);
     if (response == "") return false;
 
@@ -201,28 +290,33 @@ bool PetKitApi::_getBaseUrl()
             if (gateway.endsWith("/")) gateway.remove(gateway.length() - 1);
             _base_url = gateway;
             _region = server["id"].as<String>();
-            _log(String("Found regional server: ") + _base_url);
+            SL_LOGD("Found regional server: %s", _base_url.c_str());
             return true;
         }
     }
-    _log("Error: Your region was not found.");
+    SL_LOGE("Error: Your region was not found.");
     return false;
 }
 
-void PetKitApi::_getDevices()
+// Parsed into a spare document, so a failed request keeps the last list
+bool PetKitApi::_getDevices()
 {
-    _log("Fetching device list...");
-    String response = _sendRequest("/group/family/list", "", false);
-    if (response != "")
-    {
-        deserializeJson(_device_doc, response);
-    }
+    SL_TRACE_SCOPE("getDevices", "sync");
+    SL_LOGD("Fetching device list...");
+    JsonDocument doc;
+    if (_sendRequestJson("/group/family/list", "", 0, false, false, doc).as<JsonArray>().isNull()) return false;
+
+    _device_doc = std::move(doc);
+    // Views do not follow a moved document; find the list again
+    JsonArray result = _device_doc["result"].as<JsonArray>();
+    _device_list = result.isNull() ? _device_doc.as<JsonArray>() : result;
+    return true;
 }
 
 void PetKitApi::_parsePets()
 {
     _pets.clear();
-    JsonArray accounts = _device_doc.as<JsonArray>();
+    JsonArray accounts = _device_list;
     for (JsonObject account : accounts)
     {
         JsonArray petList = account["petList"].as<JsonArray>();
@@ -236,221 +330,464 @@ void PetKitApi::_parsePets()
     }
 }
 
-void PetKitApi::_getLitterboxData(int days_back)
+// False if the device list is missing or a day request failed
+bool PetKitApi::_getLitterboxData(int days_back, bool status_only)
 {
-    _litterbox_records.clear();
-    _status_records.clear();
+    if (!status_only)
+    {
+        _litterbox_records.clear();
+        _status_records.clear();
+        _status_table.clear();
+    }
 
-    JsonArray accounts = _device_doc.as<JsonArray>();
+    std::vector<DeviceSync> devices;
+    JsonArray accounts = _device_list;
     for (JsonObject account : accounts)
     {
-        JsonArray devices = account["deviceList"].as<JsonArray>();
-        for (JsonObject device : devices)
+        JsonArray list = account["deviceList"].as<JsonArray>();
+        for (JsonObject device : list)
         {
-            String device_type = device["deviceType"].as<String>();
-            device_type.toLowerCase();
-
-            if (device_type == "t3" || device_type == "t4" || device_type == "t5" || device_type == "t6")
-            {
-                _fetchHistoricalData(device, days_back);
-            }
+            if (!_isLitterbox(device)) continue;
+
+            DeviceSync dev;
+            dev.id = device["deviceId"].as<String>();
+            dev.name = device["deviceName"].as<String>();
+            dev.type = device["deviceType"].as<String>();
+            dev.type.toLowerCase();
+            dev.endpoint = "/" + dev.type + "/getDeviceRecord";
+            // T5 / T6 return their whole history for any one day
+            dev.days = (dev.type == "t5" || dev.type == "t6") ? 1 : days_back;
+            dev.delivered = dev.newest = _newest_seen[dev.id];
+            auto since = _delivered_since.find(dev.id);
+            if (since != _delivered_since.end()) dev.delivered_since = since->second;
+            dev.complete = true;
+            devices.push_back(dev);
         }
     }
+    bool fetched = _fetchHistoricalData(devices, !status_only) && !_device_list.isNull();
+
     // Sort records
+    SL_TRACE_SCOPE("sort records", "sync");
     std::sort(_litterbox_records.begin(), _litterbox_records.end(), [](const LitterboxRecord &a, const LitterboxRecord &b)
               { return a.timestamp > b.timestamp; });
-    std::sort(_status_records.begin(), _status_records.end(), [](const StatusRecord &a, const StatusRecord &b)
-              { return a.timestamp > b.timestamp; });
+    if (_keep_status_history)
+    {
+        std::sort(_status_records.begin(), _status_records.end(), [](const StatusRecord &a, const StatusRecord &b)
+                  { return a.timestamp > b.timestamp; });
+    }
+    return fetched;
 }
 
-void PetKitApi::_fetchHistoricalData(JsonObject device, int days_back)
+// One request per (device, day), newest day first, all independent: they go
+// out as a batch so an asynchronous transport overlaps their round trips.
+// Every fetch re-reads the whole window; only newer records are delivered.
+// store = false: status and callbacks only; stored records are left alone.
+// False if any day could not be fetched.
+bool PetKitApi::_fetchHistoricalData(std::vector<DeviceSync> &devices, bool store)
 {
     time_t now_ts;
     time(&now_ts);
-    struct tm p_tm;
-    localtime_r(&now_ts, &p_tm);
-
-    String deviceId = device["deviceId"].as<String>();
-    String deviceType = device["deviceType"].as<String>();
-    deviceType.toLowerCase();
+    struct tm today;
+    localtime_r(&now_ts, &today);
 
-    _log(String("Fetching records for ") + device["deviceName"].as<String>());
+    struct DayJob
+    {
+        size_t device;
+        int day;
+    };
+    std::vector<DayJob> jobs;
+    for (size_t d = 0; d < devices.size(); d++)
+    {
+        SL_LOGD("Fetching records for %s", devices[d].name.c_str());
+        for (int day = 0; day < devices[d].days; day++) jobs.push_back(DayJob{d, day});
+    }
 
-    JsonDocument doc;
+    RequestBatch batch(*_transport, *_scheduler, _retries_left, _max_in_flight);
+    std::vector<JsonDocument> docs(batch.window());
+    std::vector<DeserializationError> errors(batch.window());
+    std::vector<String> bodies(batch.window());
+    std::vector<String> dates(batch.window());
+    bool complete_days = true;
 
-    for (int i = 0; i < days_back; i++)
+    auto prepare = [&](size_t index, size_t slot, HttpRequest &req)
     {
-        // SAFETY: Yield to OS/Watchdog to prevent crashes during long loops
-        delay(50); 
-        if (WiFi.status() != WL_CONNECTED) {
-            _log("WiFi lost during sync. Aborting.");
-            break;
-        }
-
+        const DeviceSync &dev = devices[jobs[index].device];
         if (_ledpin > 0) digitalWrite(_ledpin, !digitalRead(_ledpin));
 
+        struct tm p_tm = today;
+        p_tm.tm_mday -= jobs[index].day;
+        mktime(&p_tm); // Normalize date (handles month rollovers)
         char date_str_ymd[9];
         strftime(date_str_ymd, sizeof(date_str_ymd), "%Y%m%d", &p_tm);
+        dates[slot] = date_str_ymd;
+
+        _form.reset();
+        _form.add((dev.type == "t3") ? "day" : "date", date_str_ymd);
+        _form.add("deviceId", dev.id);
+        bodies[slot] = _form.c_str();
+
+        _buildRequest(req, _base_url + dev.endpoint, bodies[slot].c_str(), bodies[slot].length(), true, true);
+        req.idempotent = true;  // A read; may be hedged
+        // Parsed as it arrives, on the transport's thread
+        docs[slot].clear();
+        errors[slot] = DeserializationError::EmptyInput;
+        JsonDocument *doc = &docs[slot];
+        DeserializationError *error = &errors[slot];
+        req.body_handler = [doc, error](Stream &body)
+        {
+            SL_TRACE_SCOPE("read + parse body", "json");
+            *error = deserializeJson(*doc, body);
+        };
+        return true;
+    };
 
-        String endpoint = "/" + deviceType + "/getDeviceRecord";
-        String dateKey = (deviceType == "t3") ? "day" : "date";
-        String payload_str = dateKey + "=" + String(date_str_ymd) + "&deviceId=" + deviceId;
+    auto complete = [&](size_t index, size_t slot, HttpResponse &resp, bool settled)
+    {
+        DeviceSync &dev = devices[jobs[index].device];
+        // 401 or a retryable failure: redo it the blocking way (re-login, backoff)
+        JsonVariant result = settled
+            ? _resultOf(dev.endpoint, resp, errors[slot], docs[slot])
+            : _sendRequestJson(dev.endpoint, bodies[slot].c_str(), bodies[slot].length(), true, true, docs[slot]);
+
+        if (result.isNull())
+        {
+            SL_LOGW("Failed to parse records for %s", dates[slot].c_str());
+            complete_days = false;
+            dev.complete = false;
+            return;
+        }
+        _parseDayRecords(dev, result.as<JsonArray>(), store);
+    };
 
-        String response = _sendRequest(endpoint, payload_str, true, true);
+    auto keep_going = [&]()
+    {
+        // SAFETY: Yield to OS/Watchdog. Request pacing is up to the scheduler.
+        {
+            SL_TRACE_SCOPE("yield", "sync");
+            delay(1);
+        }
+        if (_transport->isConnected()) return true;
+        SL_LOGE("WiFi lost during sync. Aborting.");
+        return false;
+    };
+
+    if (!batch.run(jobs.size(), prepare, complete, keep_going)) complete_days = false;
+
+    for (auto &dev : devices)
+    {
+        // A day that was not read (failed, or the batch stopped first) may
+        // hold records older than ones delivered from other days. A status
+        // pass reads only today, so it cannot settle a day an earlier pass missed.
+        bool missed_before = _delivered_since.count(dev.id) != 0;
+        if (dev.complete && complete_days && (store || !missed_before))
+        {
+            _newest_seen[dev.id] = dev.newest;
+            _delivered_since.erase(dev.id);
+        }
+        else
+        {
+            // Kept even when empty: it marks the window as not fully read
+            _delivered_since[dev.id].swap(dev.delivered_since);
+        }
 
-        // Clear document to prevent merging old data
-        doc.clear(); 
-        DeserializationError error = deserializeJson(doc, response);
-        
-        if (error)
+        // One status per device, its newest, if the fetch brought a newer one
+        const StatusRecord *sr = _status_table.find(dev.id);
+        time_t &status_delivered = _status_delivered[dev.id];
+        if (sr && sr->timestamp > status_delivered)
         {
-            _log(String("Failed to parse records for ") + date_str_ymd);
-            // Don't continue/break, just ensure we decrement day
+            _emitStatus(_toUnifiedStatus(*sr));
+            status_delivered = sr->timestamp;
         }
-        else 
+    }
+    return complete_days;
+}
+
+// Keys read from each day record, its content and its first subContent entry
+enum
+{
+    REC_EVENT_TYPE,
+    REC_TIMESTAMP,
+    REC_PET_ID,
+    REC_PET_NAME,
+    REC_CONTENT,
+    REC_SUB_CONTENT,
+    REC_FIELDS
+};
+static constexpr SL_Key kRecordKeys[REC_FIELDS] = {
+    SL_KEY("enumEventType"), SL_KEY("timestamp"), SL_KEY("petId"),
+    SL_KEY("petName"), SL_KEY("content"), SL_KEY("subContent")};
+
+enum
+{
+    VISIT_PET_WEIGHT,
+    VISIT_TIME_IN,
+    VISIT_TIME_OUT,
+    VISIT_FIELDS
+};
+static constexpr SL_Key kVisitKeys[VISIT_FIELDS] = {
+    SL_KEY("petWeight"), SL_KEY("timeIn"), SL_KEY("timeOut")};
+
+enum
+{
+    LEVEL_LITTER_PERCENT,
+    LEVEL_BOX_FULL,
+    LEVEL_SAND_LACK,
+    LEVEL_FIELDS
+};
+static constexpr SL_Key kLevelKeys[LEVEL_FIELDS] = {
+    SL_KEY("litterPercent"), SL_KEY("boxFull"), SL_KEY("sandLack")};
+
+void PetKitApi::_parseDayRecords(DeviceSync &dev, JsonArray records, bool store)
+{
+    SL_TRACE_SCOPE("day records", "parse");
+    for (JsonObject record : records)
+    {
+        SL_Fields<REC_FIELDS> f(record, kRecordKeys);
+        if (!f[REC_EVENT_TYPE].as<bool>()) continue;
+
+        time_t record_ts = f[REC_TIMESTAMP].as<long>();
+        // Basic validation
+        if (!f[REC_PET_ID].as<bool>() || !f[REC_CONTENT].as<bool>()) continue;
+
+        LitterboxRecord lr;
+        lr.device_name = dev.name;
+        lr.device_type = dev.type;
+        lr.pet_id = f[REC_PET_ID].as<int>();
+        lr.pet_name = f[REC_PET_NAME].as<String>();
+        lr.timestamp = record_ts;
+
+        SL_Fields<VISIT_FIELDS> visit(f[REC_CONTENT].as<JsonObjectConst>(), kVisitKeys);
+        lr.weight_grams = visit[VISIT_PET_WEIGHT].as<int>();
+        long time_in = visit[VISIT_TIME_IN].as<long>();
+        long time_out = visit[VISIT_TIME_OUT].as<long>();
+        lr.duration_seconds = (time_out > time_in) ? (time_out - time_in) : 0;
+
+        if (record_ts > dev.delivered)
         {
-            JsonArray records = doc.as<JsonArray>();
-            for (JsonObject record : records)
+            std::pair<time_t, int> key(record_ts, lr.pet_id);
+            if (std::find(dev.delivered_since.begin(), dev.delivered_since.end(), key) == dev.delivered_since.end())
             {
-                if (!record["enumEventType"]) continue;
-
-                time_t record_ts = record["timestamp"].as<long>();
-                // Basic validation
-                if (!record["petId"] || !record["content"]) continue;
-
-                LitterboxRecord lr;
-                lr.device_name = device["deviceName"].as<String>();
-                lr.device_type = deviceType;
-                lr.pet_id = record["petId"].as<int>();
-                lr.pet_name = record["petName"].as<String>();
-                lr.timestamp = record_ts;
-
-                if (record["content"])
-                {
-                    lr.weight_grams = record["content"]["petWeight"].as<int>();
-                    long time_in = record["content"]["timeIn"].as<long>();
-                    long time_out = record["content"]["timeOut"].as<long>();
-                    lr.duration_seconds = (time_out > time_in) ? (time_out - time_in) : 0;
-                }
-                _litterbox_records.push_back(lr);
-
-                if (record["subContent"])
-                {
-                    StatusRecord sr;
-                    sr.device_name = device["deviceName"].as<String>();
-                    sr.device_type = deviceType;
-                    sr.timestamp = record_ts;
-                    JsonArray subContent = record["subContent"];
-                    sr.litter_percent = subContent[0]["content"]["litterPercent"].as<int>();
-                    sr.box_full = subContent[0]["content"]["boxFull"].as<bool>();
-                    sr.sand_lack = subContent[0]["content"]["sandLack"].as<bool>();
-                    _status_records.push_back(sr);
-                }
+                SL_RecordView view;
+                _toView(lr, view);
+                _emitRecord(view);
+                dev.delivered_since.push_back(key);
             }
+            if (record_ts > dev.newest) dev.newest = record_ts;
         }
+        if (store && _store_records) _litterbox_records.push_back(lr);
 
-        // Decrement day
-        p_tm.tm_mday -= 1;
-        mktime(&p_tm); // Normalize date (handles month rollovers)
-
-        if (deviceType == "t5" || deviceType == "t6") break; 
+        if (f[REC_SUB_CONTENT].as<bool>())
+        {
+            StatusRecord sr;
+            sr.device_id = dev.id;
+            sr.device_name = dev.name;
+            sr.device_type = dev.type;
+            sr.timestamp = record_ts;
+            SL_Fields<LEVEL_FIELDS> level(f[REC_SUB_CONTENT][0]["content"].as<JsonObjectConst>(), kLevelKeys);
+            sr.litter_percent = level[LEVEL_LITTER_PERCENT].as<int>();
+            sr.box_full = level[LEVEL_BOX_FULL].as<bool>();
+            sr.sand_lack = level[LEVEL_SAND_LACK].as<bool>();
+            _status_table.update(dev.id, sr);
+            if (store && _keep_status_history) _status_records.push_back(sr);
+        }
     }
 }
 
-String PetKitApi::_urlEncode(const String &str)
+bool PetKitApi::_isLitterbox(JsonObject device)
 {
-    String encodedString = "";
-    char c;
-    char code0;
-    char code1;
-    for (unsigned int i = 0; i < str.length(); i++)
-    {
-        c = str.charAt(i);
-        if (c == ' ') encodedString += '+';
-        else if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') encodedString += c;
-        else
+    String device_type = device["deviceType"].as<String>();
+    device_type.toLowerCase();
+    return device_type == "t3" || device_type == "t4" || device_type == "t5" || device_type == "t6";
+}
+
+// Diff this fetch's statuses against the previous one and emit SL_Events
+void PetKitApi::_detectChanges()
+{
+    if (_device_list.isNull()) return; // Device list fetch failed; nothing to diff
+
+    _changes.beginRound();
+    for (JsonObject account : _device_list)
+    {
+        for (JsonObject device : account["deviceList"].as<JsonArray>())
         {
-            code1 = (c & 0xf) + '0';
-            if ((c & 0xf) > 9) code1 = (c & 0xf) - 10 + 'A';
-            c = (c >> 4) & 0xf;
-            code0 = c + '0';
-            if (c > 9) code0 = c - 10 + 'A';
-            encodedString += '%';
-            encodedString += code0;
-            encodedString += code1;
+            if (!_isLitterbox(device)) continue;
+            const StatusRecord *r = _status_table.find(device["deviceId"].as<String>());
+            if (r) _changes.observe(_toUnifiedStatus(*r), _on_event);
+            else _changes.observePresent(device["deviceName"].as<String>(), _on_event);
         }
     }
-    return encodedString;
+    _changes.endRound(_on_event);
 }
 
-String PetKitApi::_sendRequest(const String &url, const String &payload, bool isPost, bool isFormUrlEncoded)
+// Fold records older than the raw retention window into daily rollups
+void PetKitApi::_compactRecords()
 {
-    if (WiFi.status() != WL_CONNECTED) return "";
+    SL_TRACE_SCOPE("compact records", "sync");
+    // The new records are not published yet: view them in place, without ownership
+    Snapshot pending;
+    pending.records = std::shared_ptr<const std::vector<LitterboxRecord>>(std::shared_ptr<void>(), &_litterbox_records);
+    time_t cutoff = _rollups.compact(pending, time(nullptr));
+    if (cutoff == 0) return;
+
+    size_t before = _litterbox_records.size();
+    _litterbox_records.erase(std::remove_if(_litterbox_records.begin(), _litterbox_records.end(),
+                                            [cutoff](const LitterboxRecord &r) { return r.timestamp < cutoff; }),
+                             _litterbox_records.end());
+    SL_LOGD("Compacted %u raw records", (unsigned)(before - _litterbox_records.size()));
+}
 
-    HTTPClient http;
-    String finalUrl = _base_url + url;
-    
-    // Set timeout to prevent blocking indefinitely
-    http.setTimeout(10000); 
-
-    http.begin(finalUrl);
-    http.addHeader("Accept", "*/*");
-    http.addHeader("X-Api-Version", "12.4.1");
-    http.addHeader("X-Client", "android(15.1;23127PN0CG)");
-    http.addHeader("User-Agent", "okhttp/3.12.11");
-    
-    if (_session_id != "") http.addHeader("X-Session", _session_id);
+// Swap in a snapshot with the parts this fetch rebuilt; the others are shared
+// with the current one. Records and history move out of the working state.
+void PetKitApi::_publish(bool pets, bool records, bool statuses)
+{
+    std::shared_ptr<const Snapshot> current = _published.load();
+    std::shared_ptr<Snapshot> next = current ? std::make_shared<Snapshot>(*current) : std::make_shared<Snapshot>();
+    if (pets) next->pets = std::make_shared<const std::vector<Pet>>(_pets);
+    if (records)
+    {
+        next->records = std::make_shared<const std::vector<LitterboxRecord>>(std::move(_litterbox_records));
+        next->status_history = std::make_shared<const std::vector<StatusRecord>>(std::move(_status_records));
+        _litterbox_records.clear();
+        _status_records.clear();
+    }
+    if (statuses) next->statuses = std::make_shared<const DeviceStatusTable<StatusRecord>>(_status_table);
+    if (records)
+    {
+        // Copied only when compaction or new names changed it
+        _rollups.addNames(*next);
+        if (!next->rollups || next->rollups->revision() != _rollups.revision())
+        {
+            next->rollups = std::make_shared<const DailyRollupStore>(_rollups);
+        }
+    }
+    _published.publish(next);
+}
+
+void PetKitApi::_buildRequest(HttpRequest &req, const String &finalUrl, const char *payload, size_t length, bool isPost, bool isFormUrlEncoded)
+{
+    req.method = isPost ? "POST" : "GET";
+    req.url = finalUrl;
+    req.body = (const uint8_t *)payload;
+    req.body_length = isPost ? length : 0;
+    // Derived from this endpoint's measured latency; 10 s until there are samples
+    req.timeout_ms = _scheduler->timeoutFor(req, 10000);
+    req.connect_timeout_ms = _scheduler->connectTimeoutFor(req, 10000);
+
+    req.header_count = 0;
+    req.addHeader("Accept", "*/*");
+    req.addHeader("X-Api-Version", "12.4.1");
+    req.addHeader("X-Client", "android(15.1;23127PN0CG)");
+    req.addHeader("User-Agent", "okhttp/3.12.11");
+
+    if (_session_id != "") req.addHeader("X-Session", _session_id);
 
     if (isPost && isFormUrlEncoded) {
-        http.addHeader("Content-Type", "application/x-www-form-urlencoded");
+        req.addHeader("Content-Type", "application/x-www-form-urlencoded");
     } else if (isPost) {
-         http.addHeader("Content-Type", "application/json");
+         req.addHeader("Content-Type", "application/json");
     }
+}
 
-    int httpCode;
-    if (isPost) httpCode = http.POST(payload);
-    else httpCode = http.GET();
+String PetKitApi::_sendRequest(const String &url, const String &payload, bool isPost, bool isFormUrlEncoded)
+{
+    return _sendRequest(url, payload.c_str(), payload.length(), isPost, isFormUrlEncoded);
+}
 
-    String response = "";
-    
-    // Check for Session Expiry in PetKit (usually 401 or specific JSON error, but 401 is standard)
-    if (httpCode == 401) {
-        _log("Session expired. Retrying login...");
-        http.end();
-        if (login()) {
-            // Retry once
-            http.begin(finalUrl);
-            http.addHeader("Accept", "*/*");
-            http.addHeader("X-Api-Version", "12.4.1");
-            http.addHeader("X-Client", "android(15.1;23127PN0CG)");
-            http.addHeader("User-Agent", "okhttp/3.12.11");
-            http.addHeader("X-Session", _session_id); // New session
-            if (isPost && isFormUrlEncoded) http.addHeader("Content-Type", "application/x-www-form-urlencoded");
-            
-            if (isPost) httpCode = http.POST(payload);
-            else httpCode = http.GET();
+bool PetKitApi::_exchange(HttpRequest &req, HttpResponse &resp, const String &url)
+{
+    SL_TRACE_SCOPE_D("request", "http", url.c_str());
+    bool relogged = false;
+
+    for (int attempt = 0;; attempt++)
+    {
+        _scheduler->acquire(req.url.c_str());
+        unsigned long sent = millis();
+        _transport->send(req, resp);
+        _scheduler->recordLatency(req, resp, millis() - sent);
+
+        // Check for Session Expiry in PetKit (usually 401 or specific JSON error, but 401 is standard)
+        if (resp.status == 401 && !relogged && url != "/user/login") {
+            SL_LOGI("Session expired. Retrying login...");
+            relogged = true;
+            if (!login()) return false;
+            req.setHeader("X-Session", _session_id);
+            attempt--; // Re-login is not a backoff retry
+            continue;
         }
+
+        long wait_ms = _scheduler->complete(req.url.c_str(), resp.status,
+                                            RequestScheduler::parseRetryAfter(resp.retry_after),
+                                            attempt, _retries_left);
+        if (wait_ms < 0) break;
+
+        // acquire() holds off until the backoff window has passed
+        SL_LOGW("HTTP %d, retrying in %ld ms", resp.status, wait_ms);
     }
 
-    if (httpCode > 0)
+    if (resp.status > 0) return true;
+
+    SL_LOGE("HTTP Error: %s", resp.error.c_str());
+    return false;
+}
+
+String PetKitApi::_sendRequest(const String &url, const char *payload, size_t length, bool isPost, bool isFormUrlEncoded)
+{
+    if (!_transport->isConnected()) return "";
+
+    HttpRequest req;
+    HttpResponse resp;
+    _buildRequest(req, _base_url + url, payload, length, isPost, isFormUrlEncoded);
+    if (!_exchange(req, resp, url)) return "";
+
+    // Extract result wrapper if present
+    JsonDocument doc;
+    if (deserializeJson(doc, resp.body) == DeserializationError::Ok && doc["result"])
     {
-        response = http.getString();
-        
-        // Extract result wrapper if present
-        JsonDocument doc;
-        if (deserializeJson(doc, response) == DeserializationError::Ok && doc["result"])
-        {
-            String resultStr;
-            serializeJson(doc["result"], resultStr);
-            http.end();
-            return resultStr;
-        }
+        String resultStr;
+        serializeJson(doc["result"], resultStr);
+        return resultStr;
     }
-    else
+    return resp.body;
+}
+
+JsonVariant PetKitApi::_sendRequestJson(const String &url, const char *payload, size_t length, bool isPost, bool isFormUrlEncoded, JsonDocument &doc)
+{
+    doc.clear();
+    if (!_transport->isConnected()) return JsonVariant();
+
+    HttpRequest req;
+    HttpResponse resp;
+    _buildRequest(req, _base_url + url, payload, length, isPost, isFormUrlEncoded);
+
+    // Parse straight off the (possibly gzipped) socket; no body String is built
+    DeserializationError error = DeserializationError::EmptyInput;
+    req.body_handler = [&](Stream &body)
     {
-        _log(String("HTTP Error: ") + http.errorToString(httpCode).c_str());
+        SL_TRACE_SCOPE("read + parse body", "json");
+        error = deserializeJson(doc, body);
+    };
+
+    if (!_exchange(req, resp, url)) return JsonVariant();
+    return _resultOf(url, resp, error, doc);
+}
+
+// Shared by the blocking path and batched (submitted) requests
+JsonVariant PetKitApi::_resultOf(const String &url, const HttpResponse &resp, DeserializationError error, JsonDocument &doc)
+{
+    if (resp.status <= 0)
+    {
+        SL_LOGE("HTTP Error: %s", resp.error.c_str());
+        return JsonVariant();
     }
+    if (error)
+    {
+        SL_LOGW("JSON parse failed for %s: %s", url.c_str(), error.c_str());
+        return JsonVariant();
+    }
+    SL_LOGD("%s: %u bytes on the wire, %u decoded", url.c_str(),
+            (unsigned)resp.wire_bytes, (unsigned)resp.body_bytes);
 
-    http.end();
-    return response;
-}
\ No newline at end of file
+    // Unwrap the result wrapper if present
+    if (doc["result"]) return doc["result"];
+    return doc.as<JsonVariant>();
+}
@@ -2,10 +2,19 @@
 #define PetKitApi_h
 
 #include "SmartLitterbox.h"
+#include "RequestScheduler.h"
+#include "RequestBuilder.h"
 #include "Arduino.h"
-#include <HTTPClient.h>
+#include "HttpTransport.h"
+#include "RequestBatch.h"
+#include "DeviceStatusTable.h"
+#include "DailyRollupStore.h"
+#include "ChangeDetector.h"
+#include "SnapshotCell.h"
+#include "SL_Log.h"
 #include <ArduinoJson.h>
 #include <vector>
+#include <unordered_map>
 
 String md5(String str);
 
@@ -25,6 +34,7 @@ struct LitterboxRecord {
 };
 
 struct StatusRecord {
+    String device_id;
     String device_name;
     String device_type;
     time_t timestamp; 
@@ -35,16 +45,47 @@ struct StatusRecord {
 
 class PetKitApi : public SmartLitterbox {
 public:
+    // What readers see, swapped in whole at the end of each fetch. Parts the
+    // fetch did not touch are shared with the previous snapshot.
+    struct Snapshot : SL_RecordSource {
+        std::shared_ptr<const std::vector<Pet>> pets;
+        std::shared_ptr<const std::vector<LitterboxRecord>> records;      // Newest first
+        std::shared_ptr<const std::vector<StatusRecord>> status_history;  // Newest first
+        std::shared_ptr<const DeviceStatusTable<StatusRecord>> statuses;  // Newest per device
+        std::shared_ptr<const DailyRollupStore> rollups;
+
+        size_t recordCount() const override { return records->size(); }
+        bool recordAt(size_t index, SL_RecordView& out) const override {
+            _toView((*records)[index], out);
+            return true;
+        }
+        const DailyRollupStore* dailyRollups() const override { return rollups.get(); }
+    };
+
     PetKitApi(const char* username, const char* password, const char* region, const char* timezone, int led = -1);
     ~PetKitApi();
     // --- Interface Implementation ---
     bool login() override;
     bool fetchAllData(int days_back = 30) override;
     void setDebug(bool enabled) override;
+    void setLogLevel(uint8_t level) override;
+
+    // Defaults to RequestScheduler::shared()
+    void setScheduler(RequestScheduler& scheduler);
+    // Defaults to defaultHttpTransport()
+    void setTransport(HttpTransport& transport);
+    // Day requests kept in flight at once on an asynchronous transport (default
+    // SL_MAX_IN_FLIGHT); each holds one day's JsonDocument until it is parsed
+    void setMaxInFlight(size_t requests) { _max_in_flight = requests ? requests : 1; }
+
+    // Current data without copying; never waits for a running fetch
+    std::shared_ptr<const Snapshot> snapshot() const { return _published.load(); }
+    std::shared_ptr<const SL_RecordSource> recordSource() const override { return snapshot(); }
 
     std::vector<SL_Pet> getUnifiedPets() const override {
+        std::shared_ptr<const Snapshot> snap = snapshot();
         std::vector<SL_Pet> unified;
-        for (const auto& p : _pets) {
+        for (const auto& p : *snap->pets) {
             SL_Pet slp;
             slp.id = String(p.id); 
             slp.name = p.name;
@@ -55,8 +96,9 @@ public:
     }
 
     std::vector<SL_Record> getUnifiedRecords() const override {
+        std::shared_ptr<const Snapshot> snap = snapshot();
         std::vector<SL_Record> unified;
-        for (const auto& r : _litterbox_records) {
+        for (const auto& r : *snap->records) {
             SL_Record slr;
             slr.pet_name = r.pet_name;
             slr.timestamp = r.timestamp;
@@ -71,40 +113,45 @@ public:
     }
 
     // New Unified Status Implementation
+    // Newest status across all boxes; see getUnifiedStatuses() for every device
     SL_Status getUnifiedStatus() const override {
-        if (_status_records.empty()) return SL_Status{ApiType::PETKIT,"", "", 0, 0, 0, false, false, "Unknown"};
-        
-        const auto& r = _status_records.front(); // Get latest
-        SL_Status s;
-        s.api_type = ApiType::PETKIT;
-        s.device_name = r.device_name;
-        s.device_type = r.device_type;
-        s.timestamp = r.timestamp;
-        s.litter_level_percent = r.litter_percent;
-        s.waste_level_percent = r.box_full ? 100 : 0; // PetKit is binary for full/not full usually
-        s.is_drawer_full = r.box_full;
-        s.is_error_state = false; // PetKit API doesn't easily expose this in history
-        
-        if (r.box_full) s.status_text = "Drawer Full";
-        else if (r.sand_lack) s.status_text = "Low Litter";
-        else s.status_text = "Ready";
-        
-        return s;
+        std::shared_ptr<const Snapshot> snap = snapshot();
+        const StatusRecord* r = snap->statuses->newest();
+        if (!r) return SL_Status{ApiType::PETKIT,"", "", 0, 0, 0, false, false, "Unknown"};
+        return _toUnifiedStatus(*r);
+    }
+
+    void setRawRetentionDays(int days) override { _rollups.setRawRetentionDays(days); }
+
+    std::vector<SL_Status> getUnifiedStatuses() const override {
+        std::shared_ptr<const Snapshot> snap = snapshot();
+        std::vector<SL_Status> unified;
+        for (const auto& r : snap->statuses->entries()) {
+            unified.push_back(_toUnifiedStatus(r));
+        }
+        return unified;
     }
 
     // --- Original Methods ---
-    const std::vector<Pet>& getPets() const;
-    const std::vector<LitterboxRecord>& getLitterboxRecords() const;
-    const std::vector<StatusRecord>& getStatusRecords() const;
+    // Copies from the current snapshot; use snapshot() to read without copying
+    std::vector<Pet> getPets() const;
+    std::vector<LitterboxRecord> getLitterboxRecords() const;
+    // Full status history, newest first. Empty unless setKeepStatusHistory(true).
+    std::vector<StatusRecord> getStatusRecords() const;
+    // Takes effect with the next record fetch
+    void setKeepStatusHistory(bool enabled);
+    // LITTER_LOW / LITTER_REFILLED events fire when crossing this (default 20%)
+    void setLitterLowThreshold(int percent) { _changes.setLitterLowThreshold(percent); }
     std::vector<LitterboxRecord> getLitterboxRecordsByPetId(int pet_id) const;
     StatusRecord getLatestStatus() const;
+    StatusRecord getLatestStatus(const String& device_id) const;
+    std::vector<StatusRecord> getLatestStatuses() const { return snapshot()->statuses->entries(); }
 
 private:
-    void _log(const char* message);
-    void _log(const String& message);
+    void _logf(uint8_t level, const char* fmt, ...) __attribute__((format(printf, 3, 4)));
 
     int _ledpin;
-    bool _debug;
+    uint8_t _log_level;
     const char* _username;
     const char* _password;
     String _region;
@@ -112,19 +159,93 @@ private:
     String _session_id;
     String _base_url;
 
+    RequestScheduler* _scheduler;
+    HttpTransport* _transport;
+    int _retries_left;
+    size_t _max_in_flight;
+
+    FormBuilder _form;          // Reused for every day request
+    DailyRollupStore _rollups;  // Working copy; readers see the published one
+    ChangeDetector _changes;
+    // Per device id: every record up to this timestamp has been delivered to
+    // onRecord(). Advanced only by a fetch that read every day of the window.
+    std::unordered_map<String, time_t, SL_StringHash> _newest_seen;
+    // Per device id, present while a fetch missed a day: records past
+    // _newest_seen delivered since, as (timestamp, pet id), so a refetch does
+    // not resend them
+    std::unordered_map<String, std::vector<std::pair<time_t, int>>, SL_StringHash> _delivered_since;
+    // Per device id: timestamp of the last status passed to onStatus()
+    std::unordered_map<String, time_t, SL_StringHash> _status_delivered;
     JsonDocument _device_doc;
+    JsonArray _device_list;     // "result" array inside _device_doc
+    bool _keep_status_history;
+
+    // Working state of the running fetch; readers only see _published.
+    // Records and history are rebuilt by each record fetch and moved into
+    // the snapshot, so they are empty between fetches.
     std::vector<Pet> _pets;
     std::vector<LitterboxRecord> _litterbox_records;
     std::vector<StatusRecord> _status_records;
+    DeviceStatusTable<StatusRecord> _status_table;
+    SnapshotCell<Snapshot> _published;
 
     bool _getBaseUrl();
-    void _getDevices();
-    void _getLitterboxData(int days_back);
+    bool _getDevices();
+    bool _getLitterboxData(int days_back, bool status_only);
     void _parsePets();
+    void _buildRequest(HttpRequest& req, const String& finalUrl, const char* payload, size_t length, bool isPost, bool isFormUrlEncoded);
     String _sendRequest(const String& url, const String& payload, bool isPost = true, bool isFormUrlEncoded = false);
-    void _fetchHistoricalData(JsonObject device, int days_back);
+    String _sendRequest(const String& url, const char* payload, size_t length, bool isPost, bool isFormUrlEncoded);
+    JsonVariant _sendRequestJson(const String& url, const char* payload, size_t length, bool isPost, bool isFormUrlEncoded, JsonDocument& doc);
+    bool _exchange(HttpRequest& req, HttpResponse& resp, const String& url);
+    JsonVariant _resultOf(const String& url, const HttpResponse& resp, DeserializationError error, JsonDocument& doc);
+    void _compactRecords();
+    void _detectChanges();
+    void _publish(bool pets, bool records, bool statuses);
+    static bool _isLitterbox(JsonObject device);
+    // Per-device state while its day requests are in flight
+    struct DeviceSync {
+        String id;
+        String name;
+        String type;
+        String endpoint;
+        int days;
+        time_t delivered;
+        time_t newest;
+        std::vector<std::pair<time_t, int>> delivered_since;  // See _delivered_since
+        bool complete;      // Every day of the window was read
+    };
+    bool _fetchHistoricalData(std::vector<DeviceSync>& devices, bool store);
+    void _parseDayRecords(DeviceSync& dev, JsonArray records, bool store);
     String _getTimezoneOffset();
-    static String _urlEncode(const String& str);
+
+    static void _toView(const LitterboxRecord& r, SL_RecordView& out) {
+        out.pet_name = r.pet_name.c_str();
+        out.PetId = r.pet_id;
+        out.timestamp = r.timestamp;
+        out.weight_lbs = r.weight_grams * 0.00220462;
+        out.duration_seconds = (float)r.duration_seconds;
+        out.action = "Visit";
+        out.source_device = r.device_type.c_str();
+    }
+
+    static SL_Status _toUnifiedStatus(const StatusRecord& r) {
+        SL_Status s;
+        s.api_type = ApiType::PETKIT;
+        s.device_name = r.device_name;
+        s.device_type = r.device_type;
+        s.timestamp = r.timestamp;
+        s.litter_level_percent = r.litter_percent;
+        s.waste_level_percent = r.box_full ? 100 : 0; // PetKit is binary for full/not full usually
+        s.is_drawer_full = r.box_full;
+        s.is_error_state = false; // PetKit API doesn't easily expose this in history
+        
+        if (r.box_full) s.status_text = "Drawer Full";
+        else if (r.sand_lack) s.status_text = "Low Litter";
+        else s.status_text = "Ready";
+        
+        return s;
+    }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,173 @@
+#ifndef RecordChunks_h
+#define RecordChunks_h
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#define SL_RECORD_CHUNK 64
+
+// Ordered record list stored as immutable chunks that versions share. Copying
+// the list copies chunk pointers only, and an update replaces just the chunks
+// it touches, so a fetch that adds a few records to a long history copies one
+// chunk instead of every record. Readers holding an older version keep its
+// chunks alive.
+template <typename T>
+class RecordChunks {
+public:
+    typedef std::shared_ptr<const std::vector<T>> Chunk;
+
+    class const_iterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const T* pointer;
+        typedef const T& reference;
+
+        const_iterator(const std::vector<Chunk>* chunks, size_t chunk) : _chunks(chunks), _chunk(chunk), _pos(0) {}
+
+        const T& operator*() const { return (*(*_chunks)[_chunk])[_pos]; }
+        const T* operator->() const { return &**this; }
+        const_iterator& operator++() {
+            if (++_pos == (*_chunks)[_chunk]->size()) {
+                _chunk++;
+                _pos = 0;
+            }
+            return *this;
+        }
+        bool operator==(const const_iterator& o) const { return _chunk == o._chunk && _pos == o._pos; }
+        bool operator!=(const const_iterator& o) const { return !(*this == o); }
+
+    private:
+        const std::vector<Chunk>* _chunks;
+        size_t _chunk;
+        size_t _pos;
+    };
+
+    RecordChunks() : _size(0) {}
+
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+    const_iterator begin() const { return const_iterator(&_chunks, 0); }
+    const_iterator end() const { return const_iterator(&_chunks, _chunks.size()); }
+
+    const T& operator[](size_t index) const {
+        size_t c = _chunkOf(index);
+        return (*_chunks[c])[index - (c ? _ends[c - 1] : 0)];
+    }
+
+    // Merges `fresh`, sorted by `before`, skipping records equivalent to one
+    // already held. Only chunks that receive records are copied. Returns how
+    // many were added.
+    template <typename Before>
+    size_t merge(std::vector<T>& fresh, Before before) {
+        size_t held = _size;
+        std::vector<Chunk> chunks;
+        size_t from = 0;
+        for (const Chunk& chunk : _chunks) {
+            // Fresh records up to this chunk's last one belong in it
+            size_t to = from;
+            while (to < fresh.size() && !before(chunk->back(), fresh[to])) to++;
+            if (to == from) {
+                chunks.push_back(chunk);
+                continue;
+            }
+            std::vector<T> merged;
+            merged.reserve(chunk->size() + (to - from));
+            std::merge(chunk->begin(), chunk->end(), std::make_move_iterator(fresh.begin() + from),
+                       std::make_move_iterator(fresh.begin() + to), std::back_inserter(merged), before);
+            _append(chunks, merged, before);
+            from = to;
+        }
+        if (from < fresh.size()) {
+            std::vector<T> rest(std::make_move_iterator(fresh.begin() + from), std::make_move_iterator(fresh.end()));
+            _append(chunks, rest, before);
+        }
+        _chunks.swap(chunks);
+        _reindex();
+        return _size - held;
+    }
+
+    // Number of leading records for which keep() holds; keep() must hold for
+    // a prefix of the list. Whole chunks are skipped by their last record.
+    template <typename Keep>
+    size_t prefixLength(Keep keep) const {
+        size_t length = 0;
+        for (const Chunk& chunk : _chunks) {
+            if (keep(chunk->back())) {
+                length += chunk->size();
+                continue;
+            }
+            for (const T& r : *chunk) {
+                if (!keep(r)) break;
+                length++;
+            }
+            break;
+        }
+        return length;
+    }
+
+    // Keeps the first `count` records; only the chunk cut in two is copied
+    void truncate(size_t count) {
+        if (count >= _size) return;
+        size_t c = _chunkOf(count);
+        size_t start = c ? _ends[c - 1] : 0;
+        if (count > start) {
+            const std::vector<T>& chunk = *_chunks[c];
+            _chunks[c] = std::make_shared<const std::vector<T>>(chunk.begin(), chunk.begin() + (count - start));
+            c++;
+        }
+        _chunks.resize(c);
+        _reindex();
+    }
+
+    void clear() {
+        _chunks.clear();
+        _ends.clear();
+        _size = 0;
+    }
+
+private:
+    std::vector<Chunk> _chunks;     // Never empty ones
+    std::vector<size_t> _ends;      // Index one past each chunk's last record
+    size_t _size;
+
+    size_t _chunkOf(size_t index) const {
+        return std::upper_bound(_ends.begin(), _ends.end(), index) - _ends.begin();
+    }
+
+    void _reindex() {
+        _ends.resize(_chunks.size());
+        _size = 0;
+        for (size_t c = 0; c < _chunks.size(); c++) {
+            _size += _chunks[c]->size();
+            _ends[c] = _size;
+        }
+    }
+
+    // Dedupes a sorted run and appends it as one chunk, or, past twice the
+    // chunk size, as SL_RECORD_CHUNK pieces with the short one first, where
+    // later merges of the newest records land
+    template <typename Before>
+    static void _append(std::vector<Chunk>& chunks, std::vector<T>& run, Before before) {
+        run.erase(std::unique(run.begin(), run.end(), [&](const T& a, const T& b) {
+            return !before(a, b) && !before(b, a);
+        }), run.end());
+        if (run.size() <= 2 * SL_RECORD_CHUNK) {
+            chunks.push_back(std::make_shared<const std::vector<T>>(std::move(run)));
+            return;
+        }
+        size_t first = run.size() % SL_RECORD_CHUNK;
+        if (first == 0) first = SL_RECORD_CHUNK;
+        for (size_t from = 0; from < run.size();) {
+            size_t to = from == 0 ? first : from + SL_RECORD_CHUNK;
+            chunks.push_back(std::make_shared<const std::vector<T>>(std::make_move_iterator(run.begin() + from),
+                                                                    std::make_move_iterator(run.begin() + to)));
+            from = to;
+        }
+    }
+};
+
+#endif
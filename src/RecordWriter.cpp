@@ -0,0 +1,227 @@
+#include "RecordWriter.h"
+
+RecordWriter::RecordWriter(Print& out, SL_ExportFormat format, const char* measurement)
+    : _out(out),
+      _format(format),
+      _measurement(measurement),
+      _len(0),
+      _written(0)
+{
+}
+
+size_t RecordWriter::writeRecordHeader()
+{
+    if (_format != SL_ExportFormat::CSV) return 0;
+    size_t start = _written;
+    _puts("timestamp,pet_id,pet_name,weight_lbs,duration_seconds,action,source_device\n");
+    return _written - start;
+}
+
+size_t RecordWriter::writeStatusHeader()
+{
+    if (_format != SL_ExportFormat::CSV) return 0;
+    size_t start = _written;
+    _puts("timestamp,api,device_name,device_type,litter_percent,waste_percent,drawer_full,error,status\n");
+    return _written - start;
+}
+
+size_t RecordWriter::write(const SL_RecordView& r)
+{
+    size_t start = _written;
+    if (_format == SL_ExportFormat::CSV)
+    {
+        _putInt((long)r.timestamp);
+        _put(',');
+        _putInt(r.PetId);
+        _put(',');
+        _putCsvField(r.pet_name);
+        _put(',');
+        _putFloat(r.weight_lbs, 2);
+        _put(',');
+        _putFloat(r.duration_seconds, 0);
+        _put(',');
+        _putCsvField(r.action);
+        _put(',');
+        _putCsvField(r.source_device);
+        _put('\n');
+    }
+    else
+    {
+        // litterbox,pet=Luna,device=t4,action=Visit pet_id=1i,weight_lbs=9.81,duration_s=42 1700000000000000000
+        _puts(_measurement);
+        _puts(",pet=");
+        _putInfluxTag(r.pet_name);
+        _puts(",device=");
+        _putInfluxTag(r.source_device);
+        _puts(",action=");
+        _putInfluxTag(r.action);
+        _puts(" pet_id=");
+        _putInt(r.PetId);
+        _puts("i,weight_lbs=");
+        _putFloat(r.weight_lbs, 2);
+        _puts(",duration_s=");
+        _putFloat(r.duration_seconds, 0);
+        _put(' ');
+        _putTimestamp(r.timestamp);
+        _put('\n');
+    }
+    return _written - start;
+}
+
+size_t RecordWriter::write(const SL_Status& s)
+{
+    size_t start = _written;
+    const char* api = (s.api_type == ApiType::PETKIT) ? "petkit" : "whisker";
+    if (_format == SL_ExportFormat::CSV)
+    {
+        _putInt((long)s.timestamp);
+        _put(',');
+        _puts(api);
+        _put(',');
+        _putCsvField(s.device_name.c_str());
+        _put(',');
+        _putCsvField(s.device_type.c_str());
+        _put(',');
+        _putInt(s.litter_level_percent);
+        _put(',');
+        _putInt(s.waste_level_percent);
+        _put(',');
+        _put(s.is_drawer_full ? '1' : '0');
+        _put(',');
+        _put(s.is_error_state ? '1' : '0');
+        _put(',');
+        _putCsvField(s.status_text.c_str());
+        _put('\n');
+    }
+    else
+    {
+        _puts(_measurement);
+        _puts("_status,api=");
+        _puts(api);
+        _puts(",device=");
+        _putInfluxTag(s.device_name.c_str());
+        _puts(",type=");
+        _putInfluxTag(s.device_type.c_str());
+        _puts(" litter=");
+        _putInt(s.litter_level_percent);
+        _puts("i,waste=");
+        _putInt(s.waste_level_percent);
+        _puts("i,drawer_full=");
+        _puts(s.is_drawer_full ? "true" : "false");
+        _puts(",error=");
+        _puts(s.is_error_state ? "true" : "false");
+        _puts(",status=");
+        _putInfluxString(s.status_text.c_str());
+        _put(' ');
+        _putTimestamp(s.timestamp);
+        _put('\n');
+    }
+    return _written - start;
+}
+
+size_t RecordWriter::writeAll(const SmartLitterbox& box)
+{
+    size_t total = 0;
+    for (const SL_RecordView& r : box.records())
+    {
+        total += write(r);
+    }
+    flush();
+    return total;
+}
+
+size_t RecordWriter::flush()
+{
+    if (_len == 0) return 0;
+    size_t n = _out.write((const uint8_t*)_buf, _len);
+    _len = 0;
+    return n;
+}
+
+// --- Private Helper Methods ---
+
+void RecordWriter::_put(char c)
+{
+    if (_len == sizeof(_buf)) flush();
+    _buf[_len++] = c;
+    _written++;
+}
+
+void RecordWriter::_puts(const char* str)
+{
+    if (!str) return;
+    while (*str) _put(*str++);
+}
+
+void RecordWriter::_putInt(long value)
+{
+    char tmp[24];
+    snprintf(tmp, sizeof(tmp), "%ld", value);
+    _puts(tmp);
+}
+
+void RecordWriter::_putFloat(float value, int decimals)
+{
+    char tmp[24];
+    snprintf(tmp, sizeof(tmp), "%.*f", decimals, (double)value);
+    _puts(tmp);
+}
+
+void RecordWriter::_putTimestamp(time_t ts)
+{
+    if (_format == SL_ExportFormat::INFLUX)
+    {
+        // Line protocol defaults to nanosecond precision
+        char tmp[32];
+        snprintf(tmp, sizeof(tmp), "%lld000000000", (long long)ts);
+        _puts(tmp);
+    }
+    else
+    {
+        _putInt((long)ts);
+    }
+}
+
+void RecordWriter::_putCsvField(const char* str)
+{
+    if (!str) return;
+    bool quote = strpbrk(str, ",\"\r\n") != nullptr;
+    if (!quote)
+    {
+        _puts(str);
+        return;
+    }
+    _put('"');
+    for (const char* p = str; *p; p++)
+    {
+        if (*p == '"') _put('"');
+        _put(*p);
+    }
+    _put('"');
+}
+
+void RecordWriter::_putInfluxTag(const char* str)
+{
+    if (!str || !*str)
+    {
+        // Empty tag values are invalid in line protocol
+        _put('-');
+        return;
+    }
+    for (const char* p = str; *p; p++)
+    {
+        if (*p == ',' || *p == ' ' || *p == '=') _put('\\');
+        _put(*p);
+    }
+}
+
+void RecordWriter::_putInfluxString(const char* str)
+{
+    _put('"');
+    for (const char* p = str; p && *p; p++)
+    {
+        if (*p == '"' || *p == '\\') _put('\\');
+        _put(*p);
+    }
+    _put('"');
+}
@@ -0,0 +1,51 @@
+#ifndef RecordWriter_h
+#define RecordWriter_h
+
+#include <Arduino.h>
+#include "SmartLitterbox.h"
+
+// Streams records and status snapshots to any Print (SD File, Serial, WiFiClient)
+// as CSV or InfluxDB line protocol. Output is staged in a fixed member buffer and
+// flushed in chunks, so exporting never touches the heap.
+
+enum class SL_ExportFormat {
+    CSV,
+    INFLUX
+};
+
+class RecordWriter {
+public:
+    RecordWriter(Print& out, SL_ExportFormat format, const char* measurement = "litterbox");
+
+    // CSV column headers (no-op for Influx)
+    size_t writeRecordHeader();
+    size_t writeStatusHeader();
+
+    size_t write(const SL_RecordView& record);
+    size_t write(const SL_Status& status);
+
+    // Export every stored record of a provider
+    size_t writeAll(const SmartLitterbox& box);
+
+    // Push staged bytes to the Print. write() batches, so call this when done.
+    size_t flush();
+
+private:
+    void _put(char c);
+    void _puts(const char* str);
+    void _putInt(long value);
+    void _putFloat(float value, int decimals);
+    void _putTimestamp(time_t ts);
+    void _putCsvField(const char* str);
+    void _putInfluxTag(const char* str);
+    void _putInfluxString(const char* str);
+
+    Print& _out;
+    SL_ExportFormat _format;
+    const char* _measurement;
+    size_t _len;
+    size_t _written;
+    char _buf[128];
+};
+
+#endif
@@ -0,0 +1,206 @@
+#include "ReplayTransport.h"
+
+static bool readBody(FILE* f, size_t len, String& out)
+{
+    out = "";
+    if (len == 0) return fgetc(f) == '\n';
+    char* buf = (char*)malloc(len);
+    if (!buf) return false;
+    bool ok = fread(buf, 1, len, f) == len;
+    if (ok) out = String(buf, len);
+    free(buf);
+    return ok && fgetc(f) == '\n';
+}
+
+// --- RecordingTransport ---
+
+RecordingTransport::RecordingTransport(HttpTransport& inner, const char* path)
+    : _inner(inner), _path(path), _file(nullptr)
+{
+}
+
+RecordingTransport::~RecordingTransport()
+{
+    end();
+}
+
+bool RecordingTransport::begin()
+{
+    end();
+    _file = fopen(_path, "w");
+    return _file != nullptr;
+}
+
+void RecordingTransport::end()
+{
+    if (_file) fclose(_file);
+    _file = nullptr;
+}
+
+int RecordingTransport::send(const HttpRequest& req, HttpResponse& resp)
+{
+    // Buffer even streamed bodies so they can be journaled
+    HttpRequest buffered = req;
+    buffered.body_handler = nullptr;
+    int status = _inner.send(buffered, resp);
+    if (!_file)
+    {
+        deliverBody(req, resp);
+        return status;
+    }
+
+    fprintf(_file, "REQ %s %s %u\n", req.method, req.url.c_str(), (unsigned)req.body_length);
+    if (req.body_length) fwrite(req.body, 1, req.body_length, _file);
+    fputc('\n', _file);
+
+    fprintf(_file, "RES %d %s %u\n", status,
+            resp.retry_after.length() ? resp.retry_after.c_str() : "-",
+            (unsigned)resp.body.length());
+    fwrite(resp.body.c_str(), 1, resp.body.length(), _file);
+    fputc('\n', _file);
+    fflush(_file);
+
+    deliverBody(req, resp);
+    return status;
+}
+
+// --- ReplayTransport ---
+
+ReplayTransport::ReplayTransport(const char* path)
+    : _path(path),
+      _latency_ms(0),
+      _jitter_ms(0),
+      _bytes_per_sec(0),
+      _failure_rate(0),
+      _failure_status(503),
+      _rng(0x2545F491),
+      _misses(0)
+{
+}
+
+bool ReplayTransport::begin()
+{
+    _entries.clear();
+    FILE* f = fopen(_path, "r");
+    if (!f) return false;
+
+    char line[1024];
+    char method[16];
+    char url[960];
+    char retry[32];
+    unsigned len;
+    bool ok = true;
+
+    while (fgets(line, sizeof(line), f))
+    {
+        Entry e;
+        if (sscanf(line, "REQ %15s %959s %u", method, url, &len) != 3) { ok = false; break; }
+        e.method = method;
+        e.url = url;
+        if (!readBody(f, len, e.request_body)) { ok = false; break; }
+
+        if (!fgets(line, sizeof(line), f) ||
+            sscanf(line, "RES %d %31s %u", &e.status, retry, &len) != 3) { ok = false; break; }
+        e.retry_after = (strcmp(retry, "-") == 0) ? "" : retry;
+        if (!readBody(f, len, e.response_body)) { ok = false; break; }
+
+        e.used = false;
+        _entries.push_back(e);
+    }
+    fclose(f);
+    return ok;
+}
+
+void ReplayTransport::setLatency(unsigned long latency_ms, unsigned long jitter_ms)
+{
+    _latency_ms = latency_ms;
+    _jitter_ms = jitter_ms;
+}
+
+void ReplayTransport::setBandwidth(unsigned long bytes_per_sec)
+{
+    _bytes_per_sec = bytes_per_sec;
+}
+
+void ReplayTransport::setFailureRate(float probability, int status)
+{
+    _failure_rate = probability;
+    _failure_status = status;
+}
+
+int ReplayTransport::send(const HttpRequest& req, HttpResponse& resp)
+{
+    resp.reset();
+    unsigned long sent = millis();
+
+    unsigned long wait_ms = _latency_ms;
+    if (_jitter_ms) wait_ms += _next() % (_jitter_ms + 1);
+
+    if (_failure_rate > 0 && (_next() % 10000) < (uint32_t)(_failure_rate * 10000))
+    {
+        delay(wait_ms);
+        resp.status = _failure_status;
+        if (resp.status <= 0) resp.error = "injected failure";
+        return resp.status;
+    }
+
+    const Entry* e = _match(req);
+    if (!e)
+    {
+        _misses++;
+        delay(wait_ms);
+        resp.status = 404;
+        resp.body = "{}";
+        return resp.status;
+    }
+
+    if (_bytes_per_sec) wait_ms += (unsigned long)((uint64_t)(req.body_length + e->response_body.length()) * 1000 / _bytes_per_sec);
+    delay(wait_ms);
+
+    resp.status = e->status;
+    resp.body = e->response_body;
+    resp.retry_after = e->retry_after;
+    resp.wire_bytes = resp.body_bytes = resp.body.length();
+    resp.header_ms = (long)(millis() - sent);
+    if (resp.status <= 0) resp.error = "recorded failure";
+    deliverBody(req, resp);
+    return resp.status;
+}
+
+// --- Private Helper Methods ---
+
+const ReplayTransport::Entry* ReplayTransport::_match(const HttpRequest& req)
+{
+    // Preference: exact unused, exact reused, same endpoint unused, same endpoint reused.
+    // Reuse lets one recording drive any number of sync loops.
+    Entry* candidates[4] = {nullptr, nullptr, nullptr, nullptr};
+
+    for (auto& e : _entries)
+    {
+        if (e.url != req.url || e.method != req.method) continue;
+        bool same_body = e.request_body.length() == req.body_length &&
+                         (req.body_length == 0 || memcmp(e.request_body.c_str(), req.body, req.body_length) == 0);
+        int rank = (same_body ? 0 : 2) + (e.used ? 1 : 0);
+        if (!candidates[rank]) candidates[rank] = &e;
+        if (rank == 0) break;
+    }
+
+    for (Entry* e : candidates)
+    {
+        if (e)
+        {
+            e->used = true;
+            return e;
+        }
+    }
+    return nullptr;
+}
+
+uint32_t ReplayTransport::_next()
+{
+    // xorshift32: deterministic across platforms for a given seed
+    _rng ^= _rng << 13;
+    _rng ^= _rng >> 17;
+    _rng ^= _rng << 5;
+    return _rng;
+}
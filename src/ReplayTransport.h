@@ -0,0 +1,77 @@
+#ifndef ReplayTransport_h
+#define ReplayTransport_h
+
+#include "HttpTransport.h"
+#include <stdio.h>
+#include <vector>
+
+// Record / replay of provider traffic through stdio files (SD or SPIFFS mounts
+// on ESP32, plain paths on a host). Journal format, one block per exchange:
+//
+//   REQ <method> <url> <body_length>\n<body>\n
+//   RES <status> <retry_after|-> <body_length>\n<body>\n
+//
+// Login bodies contain the (hashed) password; treat journals as secrets.
+
+class RecordingTransport : public HttpTransport {
+public:
+    RecordingTransport(HttpTransport& inner, const char* path);
+    ~RecordingTransport();
+
+    bool begin();   // Opens (truncates) the journal
+    void end();
+
+    int send(const HttpRequest& req, HttpResponse& resp) override;
+    bool isConnected() override { return _inner.isConnected(); }
+
+private:
+    HttpTransport& _inner;
+    const char* _path;
+    FILE* _file;
+};
+
+class ReplayTransport : public HttpTransport {
+public:
+    explicit ReplayTransport(const char* path);
+
+    bool begin();   // Loads the whole journal into memory
+
+    // Shaping: fixed latency plus uniform jitter, and a throughput cap on bodies
+    void setLatency(unsigned long latency_ms, unsigned long jitter_ms = 0);
+    void setBandwidth(unsigned long bytes_per_sec);
+    // Fail a fraction of requests with the given status (e.g. 503, or -1 for a
+    // connection error) without consuming the recorded response
+    void setFailureRate(float probability, int status = 503);
+    void setSeed(uint32_t seed) { _rng = seed ? seed : 1; }
+
+    int send(const HttpRequest& req, HttpResponse& resp) override;
+
+    size_t entryCount() const { return _entries.size(); }
+    unsigned long missCount() const { return _misses; }
+
+private:
+    struct Entry {
+        String method;
+        String url;
+        String request_body;
+        int status;
+        String retry_after;
+        String response_body;
+        bool used;
+    };
+
+    const Entry* _match(const HttpRequest& req);
+    uint32_t _next();
+
+    const char* _path;
+    std::vector<Entry> _entries;
+    unsigned long _latency_ms;
+    unsigned long _jitter_ms;
+    unsigned long _bytes_per_sec;
+    float _failure_rate;
+    int _failure_status;
+    uint32_t _rng;
+    unsigned long _misses;
+};
+
+#endif
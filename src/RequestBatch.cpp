@@ -0,0 +1,194 @@
+#include "RequestBatch.h"
+#include "TraceBuffer.h"
+
+// Trace lanes for requests in flight, one per slot and attempt
+#define SL_BATCH_TRACE_LANE 0x5107B000u
+
+RequestBatch::RequestBatch(HttpTransport& transport, RequestScheduler& scheduler, int& retry_budget, size_t window)
+    : _transport(transport),
+      _scheduler(scheduler),
+      _retry_budget(retry_budget),
+      _window(window ? window : 1),
+      _requests(_window),
+      _flights(_window),
+      _inbox(std::make_shared<Inbox>()),
+      _serial(0),
+      _hedged(0),
+      _hedge_wins(0)
+{
+}
+
+bool RequestBatch::run(size_t count, const Prepare& prepare, const Complete& complete, const std::function<bool()>& keep_going)
+{
+    std::vector<size_t> free_slots;
+    for (size_t s = _window; s > 0; s--) free_slots.push_back(s - 1);
+
+    size_t next = 0;
+    size_t in_flight = 0;
+    bool stopped = false;
+
+    while (in_flight > 0 || (next < count && !stopped))
+    {
+        // Top up the window
+        while (!stopped && next < count && !free_slots.empty())
+        {
+            if (keep_going && !keep_going())
+            {
+                stopped = true;
+                break;
+            }
+            size_t index = next++;
+            size_t slot = free_slots.back();
+            HttpRequest& req = _requests[slot];
+            req = HttpRequest();
+            if (!prepare(index, slot, req)) continue;
+
+            free_slots.pop_back();
+            in_flight++;
+
+            Flight& f = _flights[slot];
+            f.index = index;
+            f.serial = ++_serial;
+            f.attempts = 0;
+            f.returned = 0;
+            f.active = true;
+            f.owner = std::make_shared<std::atomic<int>>(-1);
+            unsigned long hedge_ms = req.idempotent ? _scheduler.hedgeDelay(req) : 0;
+            f.hedge_pending = hedge_ms > 0;
+            // The caller reuses its body buffer with the slot; a hedged pair may not
+            f.body = (f.hedge_pending && req.body) ? std::make_shared<String>((const char*)req.body, req.body_length) : nullptr;
+
+            _scheduler.acquire(req.url.c_str());
+            f.hedge_at = millis() + hedge_ms;
+            _launch(slot, 0);
+
+            // A blocking transport has already completed it: handle that before
+            // the next submit, so only one slot's response is held at a time
+            std::lock_guard<std::mutex> lock(_inbox->mutex);
+            if (!_inbox->done.empty()) break;
+        }
+        if (in_flight == 0) break;
+
+        // Sleep until a completion arrives or the earliest hedge is due
+        Done done;
+        bool have_done;
+        {
+            std::unique_lock<std::mutex> lock(_inbox->mutex);
+            while (_inbox->done.empty())
+            {
+                long wait_ms = _nextHedge();
+                if (wait_ms < 0) _inbox->cv.wait(lock);
+                else if (wait_ms == 0 || _inbox->cv.wait_for(lock, std::chrono::milliseconds(wait_ms)) == std::cv_status::timeout) break;
+            }
+            have_done = !_inbox->done.empty();
+            if (have_done)
+            {
+                done = std::move(_inbox->done.front());
+                _inbox->done.pop_front();
+            }
+        }
+
+        if (!have_done)
+        {
+            for (size_t slot = 0; slot < _window; slot++)
+            {
+                Flight& f = _flights[slot];
+                if (!f.active || !f.hedge_pending || (long)(f.hedge_at - millis()) > 0) continue;
+                f.hedge_pending = false;
+                // Already reading its body: the server answered, only slower to send
+                if (f.owner->load() >= 0) continue;
+                // A host that is out of tokens or backing off gets no extra load
+                if (!_scheduler.tryAcquire(_requests[slot].url.c_str())) continue;
+                _hedged++;
+                _launch(slot, 1);
+            }
+            continue;
+        }
+
+        Flight& f = _flights[done.slot];
+        HttpRequest& req = _requests[done.slot];
+        if (!f.active || done.serial != f.serial) continue;  // Loser of a hedge that was already settled
+
+        f.returned++;
+        SL_TRACE_RECORD(done.attempt ? "hedged request" : "request in flight", "http", done.start_us,
+                        micros() - done.start_us, req.url.c_str(), SL_BATCH_TRACE_LANE + done.slot + done.attempt * _window);
+        _scheduler.recordLatency(req, done.resp, done.latency_ms);
+        if (!_accept(f, done)) continue;
+
+        if (done.attempt > 0) _hedge_wins++;
+        bool settled = done.resp.status != 401 &&
+                       _scheduler.complete(req.url.c_str(), done.resp.status,
+                                           RequestScheduler::parseRetryAfter(done.resp.retry_after),
+                                           0, _retry_budget) < 0;
+        complete(f.index, done.slot, done.resp, settled);
+
+        req.body_handler = nullptr;
+        f.active = false;
+        f.owner.reset();
+        f.body.reset();
+        free_slots.push_back(done.slot);
+        in_flight--;
+    }
+    return !stopped;
+}
+
+// --- Private Helper Methods ---
+
+void RequestBatch::_launch(size_t slot, int attempt)
+{
+    Flight& f = _flights[slot];
+    f.attempts++;
+
+    HttpRequest req = _requests[slot];
+    std::shared_ptr<String> body = f.body;
+    if (body) req.body = (const uint8_t*)body->c_str();
+
+    // Only one attempt may feed the slot's body_handler
+    if (req.body_handler)
+    {
+        std::shared_ptr<std::atomic<int>> owner = f.owner;
+        std::function<void(Stream&)> handler = req.body_handler;
+        req.body_handler = [owner, handler, attempt](Stream& stream) {
+            int expected = -1;
+            if (owner->compare_exchange_strong(expected, attempt) || expected == attempt) handler(stream);
+        };
+    }
+
+    std::shared_ptr<Inbox> inbox = _inbox;
+    uint32_t serial = f.serial;
+    uint32_t start_us = micros();
+    unsigned long start_ms = millis();
+    _transport.submit(req, [inbox, body, slot, serial, attempt, start_us, start_ms](HttpResponse& resp) {
+        std::lock_guard<std::mutex> lock(inbox->mutex);
+        inbox->done.push_back(Done{slot, serial, attempt, start_us, millis() - start_ms, std::move(resp)});
+        inbox->cv.notify_one();
+    });
+}
+
+// True if this attempt's response is the request's result
+bool RequestBatch::_accept(Flight& f, const Done& done)
+{
+    int owner = f.owner->load();
+    if (owner >= 0) return owner == done.attempt;   // Whoever parsed the body
+
+    // No body was handed over yet; a failure is only final if no twin is pending
+    if (f.returned < f.attempts && RequestScheduler::isRetryable(done.resp.status)) return false;
+
+    // Close the handler so a late twin cannot write into the slot's state
+    int expected = -1;
+    return f.owner->compare_exchange_strong(expected, -2);
+}
+
+// Milliseconds until the earliest pending hedge, or -1 if none
+long RequestBatch::_nextHedge()
+{
+    long wait_ms = -1;
+    for (const Flight& f : _flights)
+    {
+        if (!f.active || !f.hedge_pending) continue;
+        long left = (long)(f.hedge_at - millis());
+        if (left < 0) left = 0;
+        if (wait_ms < 0 || left < wait_ms) wait_ms = left;
+    }
+    return wait_ms;
+}
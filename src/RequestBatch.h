@@ -0,0 +1,104 @@
+#ifndef RequestBatch_h
+#define RequestBatch_h
+
+#include <Arduino.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "HttpTransport.h"
+#include "RequestScheduler.h"
+
+// Fans a set of independent requests (one per day, pet or robot) out through
+// HttpTransport::submit, keeping at most `window` in flight. Each request gets
+// a slot in [0, window) for per-request state such as its JsonDocument; a slot
+// is reused only after its completion has been handled.
+//
+// prepare() builds request `index` in its slot; body_handler, if set, runs on
+// the transport's thread. complete() always runs on the calling thread, one at
+// a time, in completion order. `settled` is false for a 401 or when the
+// scheduler wants a retry; the caller then repeats the request on its blocking
+// path, which owns re-login and backoff.
+//
+// With a blocking transport submit() completes inline; each completion is
+// handled before the next request is prepared, so the batch runs sequentially
+// through one slot, exactly like a plain loop.
+//
+// When the scheduler has hedging on, an idempotent request still pending after
+// the endpoint's p95 latency is sent a second time. The first attempt to reach its
+// body claims body_handler (the other's body is dropped) and its response is
+// the one passed to complete(); a failed attempt waits for its twin. The slot
+// is reused at once: the losing attempt runs on with its own copy of the
+// request body and its result is discarded, even after run() has returned.
+
+#ifndef SL_MAX_IN_FLIGHT
+#define SL_MAX_IN_FLIGHT 4
+#endif
+
+class RequestBatch {
+public:
+    typedef std::function<bool(size_t index, size_t slot, HttpRequest& req)> Prepare;  // false: skip index
+    typedef std::function<void(size_t index, size_t slot, HttpResponse& resp, bool settled)> Complete;
+
+    RequestBatch(HttpTransport& transport, RequestScheduler& scheduler, int& retry_budget, size_t window);
+
+    // False if prepare() stopped the batch early (e.g. link down)
+    bool run(size_t count, const Prepare& prepare, const Complete& complete, const std::function<bool()>& keep_going = nullptr);
+
+    size_t window() const { return _window; }
+    // Duplicates sent by this batch, and how many of them answered first
+    size_t hedged() const { return _hedged; }
+    size_t hedgeWins() const { return _hedge_wins; }
+
+private:
+    struct Done {
+        size_t slot;
+        uint32_t serial;            // Flight the attempt belongs to
+        int attempt;
+        uint32_t start_us;
+        unsigned long latency_ms;
+        HttpResponse resp;
+    };
+
+    // Completions land here from the transport's threads. Shared, so attempts
+    // still out when the batch is gone have somewhere to go.
+    struct Inbox {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<Done> done;
+    };
+
+    // Attempts of the request occupying a slot
+    struct Flight {
+        size_t index = 0;
+        uint32_t serial = 0;
+        int attempts = 0;
+        int returned = 0;
+        bool active = false;
+        bool hedge_pending = false;
+        unsigned long hedge_at = 0; // millis() at which to send the duplicate
+        std::shared_ptr<std::atomic<int>> owner;  // Attempt that got the body; -1 none, -2 closed
+        std::shared_ptr<String> body;             // Copy that may outlive the slot (hedgeable only)
+    };
+
+    void _launch(size_t slot, int attempt);
+    bool _accept(Flight& f, const Done& done);
+    long _nextHedge();
+
+    HttpTransport& _transport;
+    RequestScheduler& _scheduler;
+    int& _retry_budget;
+    size_t _window;
+
+    std::vector<HttpRequest> _requests;
+    std::vector<Flight> _flights;
+    std::shared_ptr<Inbox> _inbox;
+    uint32_t _serial;
+    size_t _hedged;
+    size_t _hedge_wins;
+};
+
+#endif
@@ -0,0 +1,86 @@
+#include "RequestBuilder.h"
+
+static bool isUnreserved(char c)
+{
+    return isalnum((unsigned char)c) || c == '-' || c == '_' || c == '.' || c == '~';
+}
+
+// --- FormBuilder ---
+
+void FormBuilder::reset()
+{
+    _len = 0;
+    _overflow = false;
+    _buf[0] = 0;
+}
+
+size_t FormBuilder::encodedLength(const char* str)
+{
+    size_t n = 0;
+    for (const char* p = str; *p; p++)
+    {
+        n += (isUnreserved(*p) || *p == ' ') ? 1 : 3;
+    }
+    return n;
+}
+
+bool FormBuilder::add(const char* key, const char* value)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    if (!value) value = "";
+
+    size_t needed = (_len > 0 ? 1 : 0) + strlen(key) + 1 + encodedLength(value);
+    if (_len + needed >= sizeof(_buf))
+    {
+        _overflow = true;
+        return false;
+    }
+
+    char* out = _buf + _len;
+    if (_len > 0) *out++ = '&';
+    for (const char* p = key; *p; p++) *out++ = *p;
+    *out++ = '=';
+    for (const char* p = value; *p; p++)
+    {
+        unsigned char c = (unsigned char)*p;
+        if (c == ' ') *out++ = '+';
+        else if (isUnreserved(c)) *out++ = c;
+        else
+        {
+            *out++ = '%';
+            *out++ = hex[c >> 4];
+            *out++ = hex[c & 0xf];
+        }
+    }
+    *out = 0;
+    _len += needed;
+    return true;
+}
+
+bool FormBuilder::addJson(const char* key, const JsonDocument& doc)
+{
+    // Staging buffer; the encoded form still has to fit in _buf afterwards
+    char json[SL_FORM_BUFFER_SIZE / 2];
+    size_t n = serializeJson(doc, json, sizeof(json));
+    if (n == 0 || n >= sizeof(json) - 1)
+    {
+        _overflow = true;
+        return false;
+    }
+    return add(key, json);
+}
+
+// --- GraphQLRequest ---
+
+GraphQLRequest::GraphQLRequest(const char* query)
+{
+    _doc["query"] = query;
+    _vars = _doc["variables"].to<JsonObject>();
+}
+
+void GraphQLRequest::serialize(String& out) const
+{
+    out = "";
+    out.reserve(measureJson(_doc));
+    serializeJson(_doc, out);
+}
@@ -0,0 +1,54 @@
+#ifndef RequestBuilder_h
+#define RequestBuilder_h
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// --- Form (application/x-www-form-urlencoded) ---
+// Fields are percent-encoded straight into a fixed buffer that the owner reuses
+// across requests. Each field's encoded length is measured before it is written,
+// so a field either fits completely or the builder is flagged as overflowed.
+
+#ifndef SL_FORM_BUFFER_SIZE
+#define SL_FORM_BUFFER_SIZE 768
+#endif
+
+class FormBuilder {
+public:
+    FormBuilder() { reset(); }
+
+    void reset();
+    bool add(const char* key, const char* value);
+    bool add(const char* key, const String& value) { return add(key, value.c_str()); }
+    // Serialize a JSON document and add it as one encoded field
+    bool addJson(const char* key, const JsonDocument& doc);
+
+    const char* c_str() const { return _buf; }
+    size_t length() const { return _len; }
+    bool overflowed() const { return _overflow; }
+
+    static size_t encodedLength(const char* str);
+
+private:
+    size_t _len;
+    bool _overflow;
+    char _buf[SL_FORM_BUFFER_SIZE];
+};
+
+// --- GraphQL ---
+// Variables are native JSON values in the request document, so the body is
+// serialized once into a String reserved to the measured size.
+
+class GraphQLRequest {
+public:
+    explicit GraphQLRequest(const char* query);
+
+    JsonObject vars() { return _vars; }
+    void serialize(String& out) const;
+
+private:
+    JsonDocument _doc;
+    JsonObject _vars;
+};
+
+#endif
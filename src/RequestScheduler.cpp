@@ -0,0 +1,318 @@
+#include "RequestScheduler.h"
+#include "TraceBuffer.h"
+#include <algorithm>
+
+RequestScheduler::RequestScheduler()
+    : _host_count(0),
+      _endpoint_count(0),
+      _initial_rate(5.0),
+      _min_rate(0.5),
+      _max_rate(20.0),
+      _burst(5.0),
+      _base_backoff_ms(500),
+      _max_backoff_ms(30000),
+      _retry_budget(10),
+      _min_timeout_ms(3000),
+      _max_timeout_ms(30000),
+      _hedging(false)
+{
+}
+
+RequestScheduler& RequestScheduler::shared()
+{
+    static RequestScheduler instance;
+    return instance;
+}
+
+void RequestScheduler::setRateLimits(float initial_per_sec, float min_per_sec, float max_per_sec, float burst)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _initial_rate = initial_per_sec;
+    _min_rate = min_per_sec;
+    _max_rate = max_per_sec;
+    _burst = burst;
+}
+
+void RequestScheduler::setBackoff(unsigned long base_ms, unsigned long max_ms)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _base_backoff_ms = base_ms;
+    _max_backoff_ms = max_ms;
+}
+
+void RequestScheduler::setTimeoutBounds(unsigned long min_ms, unsigned long max_ms)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _min_timeout_ms = min_ms;
+    _max_timeout_ms = max_ms < min_ms ? min_ms : max_ms;
+}
+
+void RequestScheduler::acquire(const char* url)
+{
+    while (true)
+    {
+        unsigned long wait_ms = 0;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            HostState* h = _host(url);
+            unsigned long now = millis();
+            _refill(*h, now);
+
+            if ((long)(h->blocked_until - now) > 0)
+            {
+                wait_ms = h->blocked_until - now;
+            }
+            else if (h->tokens >= 1.0)
+            {
+                h->tokens -= 1.0;
+                return;
+            }
+            else
+            {
+                wait_ms = (unsigned long)((1.0 - h->tokens) * 1000.0 / h->rate) + 1;
+            }
+        }
+        SL_TRACE_SCOPE("pacing wait", "sched");
+        delay(wait_ms);
+    }
+}
+
+bool RequestScheduler::tryAcquire(const char* url)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    HostState* h = _host(url);
+    unsigned long now = millis();
+    _refill(*h, now);
+    if ((long)(h->blocked_until - now) > 0 || h->tokens < 1.0) return false;
+    h->tokens -= 1.0;
+    return true;
+}
+
+long RequestScheduler::complete(const char* url, int http_code, long retry_after_s, int attempt, int& budget)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    HostState* h = _host(url);
+
+    if (!isRetryable(http_code))
+    {
+        // Server is keeping up: probe for more throughput. A 4xx is final but
+        // says nothing about the server's capacity.
+        if (http_code >= 200 && http_code < 400)
+        {
+            h->rate += 0.25;
+            if (h->rate > _max_rate) h->rate = _max_rate;
+        }
+        return -1;
+    }
+
+    h->rate *= (http_code == 429) ? 0.5 : 0.75;
+    if (h->rate < _min_rate) h->rate = _min_rate;
+    h->tokens = 0;
+
+    if (budget <= 0) return -1;
+    budget--;
+
+    unsigned long wait_ms;
+    if (retry_after_s >= 0)
+    {
+        wait_ms = (unsigned long)retry_after_s * 1000UL;
+        if (wait_ms > _max_backoff_ms) wait_ms = _max_backoff_ms;
+    }
+    else
+    {
+        // Full jitter: uniform in [0, min(cap, base * 2^attempt)]
+        unsigned long ceiling = _base_backoff_ms << (attempt < 16 ? attempt : 16);
+        if (ceiling > _max_backoff_ms || ceiling == 0) ceiling = _max_backoff_ms;
+        wait_ms = (unsigned long)random((long)ceiling + 1);
+    }
+
+    h->blocked_until = millis() + wait_ms;
+    return (long)wait_ms;
+}
+
+void RequestScheduler::recordLatency(const HttpRequest& req, const HttpResponse& resp, unsigned long elapsed_ms)
+{
+    if (resp.status <= 0) return;
+    unsigned long latency_ms = resp.header_ms >= 0 ? (unsigned long)resp.header_ms : elapsed_ms;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    Endpoint* e = _endpoint(req);
+    if (!e) return;
+
+    float r = (float)latency_ms;
+    if (e->srtt == 0)
+    {
+        e->srtt = r;
+        e->rttvar = r / 2;
+    }
+    else
+    {
+        e->rttvar = 0.75f * e->rttvar + 0.25f * fabsf(e->srtt - r);
+        e->srtt = 0.875f * e->srtt + 0.125f * r;
+    }
+
+    e->samples[e->sample_count++ % SL_SCHED_LATENCY_SAMPLES] = (uint16_t)(latency_ms < 65535 ? latency_ms : 65535);
+    if (e->sample_count >= SL_SCHED_MIN_SAMPLES && (e->sample_count % 4 == 0 || e->p95 == 0))
+    {
+        uint16_t sorted[SL_SCHED_LATENCY_SAMPLES];
+        size_t n = std::min<size_t>(e->sample_count, SL_SCHED_LATENCY_SAMPLES);
+        memcpy(sorted, e->samples, n * sizeof(sorted[0]));
+        size_t k = (n * 95 + 99) / 100 - 1;
+        std::nth_element(sorted, sorted + k, sorted + n);
+        e->p95 = sorted[k];
+    }
+}
+
+unsigned long RequestScheduler::timeoutFor(const HttpRequest& req, unsigned long fallback_ms)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    Endpoint* e = _endpoint(req);
+    if (!e || e->sample_count < SL_SCHED_MIN_SAMPLES) return fallback_ms;
+
+    // Twice the RTO leaves room for a slow response without waiting out a stall
+    unsigned long timeout = 2 * _baseTimeout(*e);
+    if (timeout < _min_timeout_ms) timeout = _min_timeout_ms;
+    if (timeout > _max_timeout_ms) timeout = _max_timeout_ms;
+    return timeout;
+}
+
+unsigned long RequestScheduler::connectTimeoutFor(const HttpRequest& req, unsigned long fallback_ms)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    Endpoint* e = _endpoint(req);
+    if (!e || e->sample_count < SL_SCHED_MIN_SAMPLES) return fallback_ms;
+
+    // DNS + TCP + TLS rarely take longer than a whole typical request
+    unsigned long timeout = _baseTimeout(*e);
+    unsigned long floor_ms = _min_timeout_ms * 2 / 3;
+    if (timeout < floor_ms) timeout = floor_ms;
+    if (timeout > _max_timeout_ms) timeout = _max_timeout_ms;
+    return timeout;
+}
+
+unsigned long RequestScheduler::hedgeDelay(const HttpRequest& req)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_hedging) return 0;
+    Endpoint* e = _endpoint(req);
+    if (!e || e->sample_count < SL_SCHED_MIN_SAMPLES) return 0;
+    return e->p95 > 0 ? e->p95 : 1;
+}
+
+bool RequestScheduler::isRetryable(int http_code)
+{
+    return http_code <= 0 || http_code == 429 || (http_code >= 500 && http_code <= 599);
+}
+
+long RequestScheduler::parseRetryAfter(const String& header)
+{
+    // Only the delta-seconds form; HTTP-dates fall back to our own backoff
+    if (header.length() == 0) return -1;
+    for (unsigned int i = 0; i < header.length(); i++)
+    {
+        if (!isdigit(header.charAt(i))) return -1;
+    }
+    return header.toInt();
+}
+
+uint8_t RequestScheduler::sizeClass(unsigned long items)
+{
+    uint8_t size_class = 0;
+    for (unsigned long limit = 16; items > limit && size_class < 7; limit *= 4) size_class++;
+    return size_class;
+}
+
+// --- Private Helper Methods ---
+
+RequestScheduler::HostState* RequestScheduler::_host(const char* url)
+{
+    // "https://host:port/path" -> "host:port"
+    const char* start = strstr(url, "://");
+    start = start ? start + 3 : url;
+    size_t len = strcspn(start, "/?#");
+    if (len >= sizeof(_hosts[0].host)) len = sizeof(_hosts[0].host) - 1;
+
+    unsigned long now = millis();
+    for (int i = 0; i < _host_count; i++)
+    {
+        if (strncmp(_hosts[i].host, start, len) == 0 && _hosts[i].host[len] == 0)
+        {
+            _hosts[i].last_used = now;
+            return &_hosts[i];
+        }
+    }
+
+    int slot = _host_count;
+    if (slot < SL_SCHED_MAX_HOSTS)
+    {
+        _host_count++;
+    }
+    else
+    {
+        // Evict the least recently used host, keeping those still backing off
+        // unless every host is
+        slot = -1;
+        bool slot_blocked = true;
+        for (int i = 0; i < _host_count; i++)
+        {
+            bool blocked = (long)(_hosts[i].blocked_until - now) > 0;
+            if (slot < 0 || (slot_blocked && !blocked) ||
+                (blocked == slot_blocked && now - _hosts[i].last_used > now - _hosts[slot].last_used))
+            {
+                slot = i;
+                slot_blocked = blocked;
+            }
+        }
+    }
+
+    HostState& h = _hosts[slot];
+    memcpy(h.host, start, len);
+    h.host[len] = 0;
+    h.rate = _initial_rate;
+    h.tokens = _burst;
+    h.last_refill = now;
+    h.blocked_until = now;
+    h.last_used = now;
+    return &h;
+}
+
+RequestScheduler::Endpoint* RequestScheduler::_endpoint(const HttpRequest& req)
+{
+    // "https://host:port/path?query" -> "host:port/path"
+    const char* url = req.url.c_str();
+    const char* start = strstr(url, "://");
+    start = start ? start + 3 : url;
+    size_t len = strcspn(start, "?#");
+    if (len >= sizeof(_endpoints[0].key)) len = sizeof(_endpoints[0].key) - 1;
+
+    for (int i = 0; i < _endpoint_count; i++)
+    {
+        Endpoint& e = _endpoints[i];
+        if (e.size_class == req.size_class && strncmp(e.key, start, len) == 0 && e.key[len] == 0) return &e;
+    }
+    if (_endpoint_count == SL_SCHED_MAX_ENDPOINTS) return nullptr;
+
+    Endpoint& e = _endpoints[_endpoint_count++];
+    memcpy(e.key, start, len);
+    e.key[len] = 0;
+    e.size_class = req.size_class;
+    e.srtt = 0;
+    e.rttvar = 0;
+    e.sample_count = 0;
+    e.p95 = 0;
+    return &e;
+}
+
+void RequestScheduler::_refill(HostState& h, unsigned long now)
+{
+    h.tokens += (now - h.last_refill) * h.rate / 1000.0;
+    if (h.tokens > _burst) h.tokens = _burst;
+    h.last_refill = now;
+}
+
+// RFC 6298 RTO (srtt + 4 * rttvar), but never below the observed p95
+unsigned long RequestScheduler::_baseTimeout(const Endpoint& e) const
+{
+    unsigned long rto = (unsigned long)(e.srtt + 4 * e.rttvar);
+    return rto > e.p95 ? rto : e.p95;
+}
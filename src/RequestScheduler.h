@@ -0,0 +1,120 @@
+#ifndef RequestScheduler_h
+#define RequestScheduler_h
+
+#include <Arduino.h>
+#include <mutex>
+#include "HttpTransport.h"
+
+// Paces cloud requests for all providers.
+// - Token bucket per host. The refill rate adapts AIMD-style: it creeps up
+//   while the server answers, and halves on 429 so we settle just below the
+//   throttle point instead of sleeping a fixed amount between requests.
+//   Only 2xx/3xx answers raise it. When the host table is full, the least
+//   recently used host not backing off is evicted, so every host is paced.
+// - Exponential backoff with full jitter on 429 / 5xx / connection errors,
+//   honoring Retry-After. A backoff blocks the whole host, not just one call.
+// - Retries are drawn from a per-sync budget owned by the caller, so a dead
+//   backend fails a sync quickly instead of retrying every request.
+// - Latency per endpoint (smoothed RTT and variance as in RFC 6298, plus a p95
+//   over recent samples) sets request timeouts, so a stalled request is cut
+//   off after a few typical round trips while slow regions still get room.
+//   An endpoint is host + path and the request's size class, so a device list
+//   and a 200-entry history are not timed against each other. Samples run from
+//   send to the response headers; body download and parsing are left out.
+//   Optionally, an idempotent read still pending after the p95 is hedged: a
+//   duplicate is sent and whichever answers first is used (see RequestBatch).
+
+#define SL_SCHED_MAX_HOSTS 8
+#define SL_SCHED_MAX_ENDPOINTS 12
+#define SL_SCHED_LATENCY_SAMPLES 64  // Recent samples per endpoint for the p95
+#define SL_SCHED_MIN_SAMPLES 8       // Fewer than this: fixed timeouts, no hedging
+
+class RequestScheduler {
+public:
+    RequestScheduler();
+
+    // Process-wide instance so providers (and accounts) on the same host share buckets
+    static RequestScheduler& shared();
+
+    void setRateLimits(float initial_per_sec, float min_per_sec, float max_per_sec, float burst);
+    void setBackoff(unsigned long base_ms, unsigned long max_ms);
+    void setRetryBudget(int retries_per_sync) { _retry_budget = retries_per_sync; }
+    int retryBudget() const { return _retry_budget; }
+    // Bounds for derived timeouts (defaults 3 s and 30 s)
+    void setTimeoutBounds(unsigned long min_ms, unsigned long max_ms);
+    // Send a duplicate of idempotent batched reads that outlive the p95 (default off)
+    void setHedging(bool enabled) { _hedging = enabled; }
+
+    // Block until the host has a token and is not backing off
+    void acquire(const char* url);
+    // Take a token only if one is free now (used for hedged duplicates)
+    bool tryAcquire(const char* url);
+
+    // Report the outcome of an attempt. Returns how long to wait before retrying,
+    // or -1 when the result is final (success, non-retryable, or budget spent).
+    // retry_after_s is the Retry-After header value, or -1 if absent.
+    long complete(const char* url, int http_code, long retry_after_s, int attempt, int& budget);
+
+    // Latency of one attempt: resp.header_ms, or elapsed_ms (send to
+    // completion) when the transport did not measure it. Attempts that did
+    // not reach the server are ignored.
+    void recordLatency(const HttpRequest& req, const HttpResponse& resp, unsigned long elapsed_ms);
+    // Whole-request and connect timeouts for req's endpoint; fallback_ms until
+    // enough latency samples have been seen
+    unsigned long timeoutFor(const HttpRequest& req, unsigned long fallback_ms);
+    unsigned long connectTimeoutFor(const HttpRequest& req, unsigned long fallback_ms);
+    // How long to wait before hedging req; 0 = don't hedge
+    unsigned long hedgeDelay(const HttpRequest& req);
+
+    static bool isRetryable(int http_code);
+    static long parseRetryAfter(const String& header);
+    // HttpRequest::size_class for a response of about `items` entries: one
+    // class per factor of four, from <= 16
+    static uint8_t sizeClass(unsigned long items);
+
+private:
+    struct HostState {
+        char host[48];
+        float rate;
+        float tokens;
+        unsigned long last_refill;
+        unsigned long blocked_until;
+        unsigned long last_used;    // For eviction when the table is full
+    };
+
+    struct Endpoint {
+        char key[64];   // host + path, without the query
+        uint8_t size_class;
+
+        float srtt;     // Smoothed latency, ms; 0 until the first sample
+        float rttvar;
+        uint16_t samples[SL_SCHED_LATENCY_SAMPLES];  // ms, capped at 65 s
+        uint32_t sample_count;
+        unsigned long p95;  // Cached; recomputed every few samples
+    };
+
+    // Never null: evicts the least recently used host when the table is full
+    HostState* _host(const char* url);
+    Endpoint* _endpoint(const HttpRequest& req);
+    void _refill(HostState& h, unsigned long now);
+    unsigned long _baseTimeout(const Endpoint& e) const;
+
+    std::mutex _mutex;
+    HostState _hosts[SL_SCHED_MAX_HOSTS];
+    int _host_count;
+    Endpoint _endpoints[SL_SCHED_MAX_ENDPOINTS];
+    int _endpoint_count;
+
+    float _initial_rate;
+    float _min_rate;
+    float _max_rate;
+    float _burst;
+    unsigned long _base_backoff_ms;
+    unsigned long _max_backoff_ms;
+    int _retry_budget;
+    unsigned long _min_timeout_ms;
+    unsigned long _max_timeout_ms;
+    bool _hedging;
+};
+
+#endif
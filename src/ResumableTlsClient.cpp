@@ -0,0 +1,332 @@
+#include "ResumableTlsClient.h"
+#include "TraceBuffer.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/net_sockets.h"
+#include <errno.h>
+#include <netdb.h>
+#include <new>
+#include <sys/socket.h>
+
+// Master secret of the last handshake
+struct MasterSecret
+{
+    unsigned char bytes[SL_TLS_MASTER_LEN];
+    bool known;
+};
+
+struct ResumableTlsClient::Tls
+{
+    mbedtls_net_context net;
+    mbedtls_ssl_context ssl;
+    mbedtls_ssl_config conf;
+    mbedtls_ctr_drbg_context drbg;
+    mbedtls_entropy_context entropy;
+    mbedtls_x509_crt ca;
+    MasterSecret master;
+};
+
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000
+// 3.x keeps the session fields private; the master secret is only exported
+static void captureMaster(void* p, mbedtls_ssl_key_export_type type, const unsigned char* secret, size_t len,
+                          const unsigned char*, const unsigned char*, mbedtls_tls_prf_types)
+{
+    if (type != MBEDTLS_SSL_KEY_EXPORT_TLS12_MASTER_SECRET || len != SL_TLS_MASTER_LEN) return;
+    MasterSecret* master = (MasterSecret*)p;
+    memcpy(master->bytes, secret, len);
+    master->known = true;
+}
+#endif
+
+// mbedtls_net_connect() with the TCP connect bounded by timeout_ms; the
+// blocking one waits for the OS timeout when a host does not answer
+static int connectWithTimeout(mbedtls_net_context* net, const char* host, const char* port, unsigned long timeout_ms)
+{
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+
+    struct addrinfo* list = nullptr;
+    if (getaddrinfo(host, port, &hints, &list) != 0 || !list) return MBEDTLS_ERR_NET_UNKNOWN_HOST;
+
+    int ret = MBEDTLS_ERR_NET_UNKNOWN_HOST;
+    unsigned long start = millis();
+    for (struct addrinfo* cur = list; cur; cur = cur->ai_next)
+    {
+        unsigned long elapsed = millis() - start;
+        if (elapsed >= timeout_ms)
+        {
+            ret = MBEDTLS_ERR_SSL_TIMEOUT;
+            break;
+        }
+
+        net->fd = socket(cur->ai_family, cur->ai_socktype, cur->ai_protocol);
+        if (net->fd < 0)
+        {
+            ret = MBEDTLS_ERR_NET_SOCKET_FAILED;
+            continue;
+        }
+
+        ret = MBEDTLS_ERR_NET_CONNECT_FAILED;
+        mbedtls_net_set_nonblock(net);
+        bool done = connect(net->fd, cur->ai_addr, cur->ai_addrlen) == 0;
+        if (!done && errno == EINPROGRESS)
+        {
+            int ready = mbedtls_net_poll(net, MBEDTLS_NET_POLL_WRITE, (uint32_t)(timeout_ms - elapsed));
+            if (ready == 0) ret = MBEDTLS_ERR_SSL_TIMEOUT;
+            if (ready > 0)
+            {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                done = getsockopt(net->fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0;
+            }
+        }
+        if (done && mbedtls_net_set_block(net) == 0)
+        {
+            ret = 0;
+            break;
+        }
+        mbedtls_net_free(net);
+    }
+    freeaddrinfo(list);
+    return ret;
+}
+
+ResumableTlsClient::ResumableTlsClient(TlsSessionCache& cache)
+    : _cache(cache),
+      _ca_pem(nullptr),
+      _timeout_ms(10000),
+      _tls(nullptr),
+      _connected(false),
+      _peek(-1),
+      _last_error(0),
+      _handshake_ms(0),
+      _resumed(false)
+{
+}
+
+ResumableTlsClient::~ResumableTlsClient()
+{
+    stop();
+}
+
+int ResumableTlsClient::connect(IPAddress ip, uint16_t port)
+{
+    return connect(ip.toString().c_str(), port, (int32_t)_timeout_ms);
+}
+
+int ResumableTlsClient::connect(IPAddress ip, uint16_t port, int32_t timeout_ms)
+{
+    return connect(ip.toString().c_str(), port, timeout_ms);
+}
+
+int ResumableTlsClient::connect(const char* host, uint16_t port)
+{
+    return connect(host, port, (int32_t)_timeout_ms);
+}
+
+int ResumableTlsClient::connect(const char* host, uint16_t port, int32_t timeout_ms)
+{
+    stop();
+    if (timeout_ms > 0) _timeout_ms = timeout_ms;
+
+    _tls = new (std::nothrow) Tls();
+    if (!_tls)
+    {
+        _last_error = MBEDTLS_ERR_SSL_ALLOC_FAILED;
+        return 0;
+    }
+    Tls& t = *_tls;
+    mbedtls_net_init(&t.net);
+    mbedtls_ssl_init(&t.ssl);
+    mbedtls_ssl_config_init(&t.conf);
+    mbedtls_ctr_drbg_init(&t.drbg);
+    mbedtls_entropy_init(&t.entropy);
+    mbedtls_x509_crt_init(&t.ca);
+    t.master.known = false;
+
+    char port_str[6];
+    snprintf(port_str, sizeof(port_str), "%u", port);
+    unsigned char offered_master[SL_TLS_MASTER_LEN];
+    bool offered;
+    unsigned long start;
+    uint32_t trace_us = micros();
+    int ret;
+
+    if ((ret = mbedtls_ctr_drbg_seed(&t.drbg, mbedtls_entropy_func, &t.entropy, (const unsigned char*)"sl_tls", 6)) != 0) goto fail;
+    if ((ret = connectWithTimeout(&t.net, host, port_str, _timeout_ms)) != 0) goto fail;
+    SL_TRACE_RECORD("dns + tcp connect", "net", trace_us, micros() - trace_us, host, 0);
+    if ((ret = mbedtls_ssl_config_defaults(&t.conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT)) != 0) goto fail;
+
+    if (_ca_pem)
+    {
+        if ((ret = mbedtls_x509_crt_parse(&t.ca, (const unsigned char*)_ca_pem, strlen(_ca_pem) + 1)) != 0) goto fail;
+        mbedtls_ssl_conf_ca_chain(&t.conf, &t.ca, nullptr);
+        mbedtls_ssl_conf_authmode(&t.conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+    }
+    else
+    {
+        mbedtls_ssl_conf_authmode(&t.conf, MBEDTLS_SSL_VERIFY_NONE);
+    }
+    mbedtls_ssl_conf_rng(&t.conf, mbedtls_ctr_drbg_random, &t.drbg);
+    mbedtls_ssl_conf_read_timeout(&t.conf, _timeout_ms);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    mbedtls_ssl_conf_session_tickets(&t.conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+
+    if ((ret = mbedtls_ssl_setup(&t.ssl, &t.conf)) != 0) goto fail;
+    if ((ret = mbedtls_ssl_set_hostname(&t.ssl, host)) != 0) goto fail;
+    mbedtls_ssl_set_bio(&t.ssl, &t.net, mbedtls_net_send, nullptr, mbedtls_net_recv_timeout);
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000
+    mbedtls_ssl_set_export_keys_cb(&t.ssl, captureMaster, &t.master);
+#endif
+
+    offered = _cache.apply(host, &t.ssl, offered_master);
+
+    trace_us = micros();
+    start = millis();
+    while ((ret = mbedtls_ssl_handshake(&t.ssl)) != 0)
+    {
+        if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) break;
+        if (millis() - start > _timeout_ms)
+        {
+            ret = MBEDTLS_ERR_SSL_TIMEOUT;
+            break;
+        }
+    }
+    if (ret != 0)
+    {
+        // A rejected session must not be offered again
+        if (offered) _cache.remove(host);
+        goto fail;
+    }
+    _handshake_ms = millis() - start;
+
+#if MBEDTLS_VERSION_NUMBER < 0x03000000
+    memcpy(t.master.bytes, t.ssl.session->master, SL_TLS_MASTER_LEN);
+    t.master.known = true;
+#endif
+    // An abbreviated handshake (session ID or ticket) keeps the offered
+    // session's master secret; a full one derives a fresh one
+    _resumed = offered && t.master.known && memcmp(t.master.bytes, offered_master, SL_TLS_MASTER_LEN) == 0;
+    _cache.recordHandshake(_handshake_ms, _resumed);
+    SL_TRACE_RECORD(_resumed ? "tls resume" : "tls handshake", "net", trace_us, micros() - trace_us, host, 0);
+    _cache.store(host, &t.ssl, t.master.known ? t.master.bytes : nullptr);
+
+    _connected = true;
+    return 1;
+
+fail:
+    _last_error = ret;
+    stop();
+    return 0;
+}
+
+size_t ResumableTlsClient::write(uint8_t data)
+{
+    return write(&data, 1);
+}
+
+size_t ResumableTlsClient::write(const uint8_t* buf, size_t size)
+{
+    if (!_connected) return 0;
+    size_t sent = 0;
+    while (sent < size)
+    {
+        int ret = mbedtls_ssl_write(&_tls->ssl, buf + sent, size - sent);
+        if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) continue;
+        if (ret < 0)
+        {
+            _last_error = ret;
+            stop();
+            break;
+        }
+        sent += ret;
+    }
+    return sent;
+}
+
+int ResumableTlsClient::available()
+{
+    if (!_connected) return _peek >= 0 ? 1 : 0;
+
+    size_t pending = mbedtls_ssl_get_bytes_avail(&_tls->ssl);
+    if (pending == 0 && mbedtls_net_poll(&_tls->net, MBEDTLS_NET_POLL_READ, 0) > 0)
+    {
+        // Socket has data: let mbedTLS decrypt the next record
+        int ret = mbedtls_ssl_read(&_tls->ssl, nullptr, 0);
+        if (ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY || (ret < 0 && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_TIMEOUT))
+        {
+            _connected = false;
+        }
+        pending = mbedtls_ssl_get_bytes_avail(&_tls->ssl);
+    }
+    return (int)pending + (_peek >= 0 ? 1 : 0);
+}
+
+int ResumableTlsClient::read()
+{
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int ResumableTlsClient::read(uint8_t* buf, size_t size)
+{
+    if (size == 0) return 0;
+    int offset = 0;
+    if (_peek >= 0)
+    {
+        buf[0] = (uint8_t)_peek;
+        _peek = -1;
+        if (size == 1 || available() == 0) return 1;
+        offset = 1;
+    }
+    if (!_tls) return offset ? offset : -1;
+
+    int ret = mbedtls_ssl_read(&_tls->ssl, buf + offset, size - offset);
+    if (ret > 0) return ret + offset;
+    if (ret == 0 || ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) _connected = false;
+    else if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_TIMEOUT)
+    {
+        _last_error = ret;
+        _connected = false;
+    }
+    return offset ? offset : -1;
+}
+
+int ResumableTlsClient::peek()
+{
+    if (_peek >= 0) return _peek;
+    _peek = read();
+    return _peek;
+}
+
+void ResumableTlsClient::flush()
+{
+}
+
+void ResumableTlsClient::stop()
+{
+    if (_tls)
+    {
+        if (_connected) mbedtls_ssl_close_notify(&_tls->ssl);
+        mbedtls_net_free(&_tls->net);
+        mbedtls_x509_crt_free(&_tls->ca);
+        mbedtls_ssl_free(&_tls->ssl);
+        mbedtls_ssl_config_free(&_tls->conf);
+        mbedtls_ctr_drbg_free(&_tls->drbg);
+        mbedtls_entropy_free(&_tls->entropy);
+        delete _tls;
+        _tls = nullptr;
+    }
+    _connected = false;
+    _peek = -1;
+}
+
+uint8_t ResumableTlsClient::connected()
+{
+    if (_connected) return 1;
+    return (_tls && available() > 0) ? 1 : 0;
+}
@@ -0,0 +1,57 @@
+#ifndef ResumableTlsClient_h
+#define ResumableTlsClient_h
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include "TlsSessionCache.h"
+
+// TLS client for HTTPClient::begin(WiFiClient&, url) that offers a cached
+// session before the handshake. WiFiClientSecure runs setup and handshake in a
+// single call with no hook in between, so this drives mbedTLS directly.
+// Without a CA certificate the peer is not verified, like HTTPClient's default.
+// The mbedTLS contexts (a few KB) are allocated per connection, so the client
+// itself is small enough to live on a task's stack.
+
+class ResumableTlsClient : public WiFiClient {
+public:
+    explicit ResumableTlsClient(TlsSessionCache& cache = TlsSessionCache::shared());
+    ~ResumableTlsClient();
+
+    void setCACert(const char* root_ca) { _ca_pem = root_ca; }
+    // Bounds the TCP connect and the handshake, each (default 10 s)
+    void setHandshakeTimeout(unsigned long ms) { _timeout_ms = ms; }
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(IPAddress ip, uint16_t port, int32_t timeout_ms) override;
+    int connect(const char* host, uint16_t port) override;
+    int connect(const char* host, uint16_t port, int32_t timeout_ms) override;
+
+    size_t write(uint8_t data) override;
+    size_t write(const uint8_t* buf, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buf, size_t size) override;
+    int peek() override;
+    void flush() override;
+    void stop() override;
+    uint8_t connected() override;
+
+    unsigned long lastHandshakeMs() const { return _handshake_ms; }
+    bool lastResumed() const { return _resumed; }
+    int lastError() const { return _last_error; }
+
+private:
+    TlsSessionCache& _cache;
+    const char* _ca_pem;
+    unsigned long _timeout_ms;
+
+    struct Tls;
+    Tls* _tls;                  // Null when not connected
+    bool _connected;
+    int _peek;
+    int _last_error;
+    unsigned long _handshake_ms;
+    bool _resumed;
+};
+
+#endif
@@ -0,0 +1,21 @@
+#include "SL_Log.h"
+
+static Print* _sl_log_out = &Serial;
+
+void sl_setLogOutput(Print* out)
+{
+    _sl_log_out = out;
+}
+
+void sl_vlog(uint8_t level, const char* prefix, const char* fmt, va_list args)
+{
+    if (!_sl_log_out) return;
+    if (_sl_log_out == &Serial && !Serial) return;
+
+    static const char* const tags[] = {"", "[E] ", "[W] ", "[I] ", "[D] "};
+    char line[192];
+    vsnprintf(line, sizeof(line), fmt, args);
+    _sl_log_out->print(tags[level <= SL_LOG_LEVEL_DEBUG ? level : SL_LOG_LEVEL_DEBUG]);
+    if (prefix) _sl_log_out->print(prefix);
+    _sl_log_out->println(line);
+}
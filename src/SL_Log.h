@@ -0,0 +1,57 @@
+#ifndef SL_Log_h
+#define SL_Log_h
+
+#include <Arduino.h>
+#include <stdarg.h>
+
+// Leveled, printf-style logging for the providers.
+//
+// SL_LOG_LEVEL is the compile-time ceiling: calls above it expand to nothing,
+// so their format strings and arguments never reach flash or run. Below it,
+// the runtime level (setLogLevel / setDebug) is checked before any formatting.
+// Override with -DSL_LOG_LEVEL=SL_LOG_LEVEL_WARN (or NONE) in build flags.
+
+#define SL_LOG_LEVEL_NONE  0
+#define SL_LOG_LEVEL_ERROR 1
+#define SL_LOG_LEVEL_WARN  2
+#define SL_LOG_LEVEL_INFO  3
+#define SL_LOG_LEVEL_DEBUG 4
+
+#ifndef SL_LOG_LEVEL
+#define SL_LOG_LEVEL SL_LOG_LEVEL_DEBUG
+#endif
+
+// Expect a `uint8_t _log_level` member and a `_logf(level, fmt, ...)` method in scope
+#define SL_LOG_AT(level, fmt, ...) \
+    do { if ((level) <= _log_level) _logf((level), fmt, ##__VA_ARGS__); } while (0)
+
+#if SL_LOG_LEVEL >= SL_LOG_LEVEL_ERROR
+#define SL_LOGE(fmt, ...) SL_LOG_AT(SL_LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#else
+#define SL_LOGE(fmt, ...) do {} while (0)
+#endif
+
+#if SL_LOG_LEVEL >= SL_LOG_LEVEL_WARN
+#define SL_LOGW(fmt, ...) SL_LOG_AT(SL_LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#else
+#define SL_LOGW(fmt, ...) do {} while (0)
+#endif
+
+#if SL_LOG_LEVEL >= SL_LOG_LEVEL_INFO
+#define SL_LOGI(fmt, ...) SL_LOG_AT(SL_LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#else
+#define SL_LOGI(fmt, ...) do {} while (0)
+#endif
+
+#if SL_LOG_LEVEL >= SL_LOG_LEVEL_DEBUG
+#define SL_LOGD(fmt, ...) SL_LOG_AT(SL_LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define SL_LOGD(fmt, ...) do {} while (0)
+#endif
+
+// Format into a stack buffer and print one line to Serial (or setLogOutput),
+// tagged with the level: "[E] ", "[W] ", "[I] " or "[D] "
+void sl_vlog(uint8_t level, const char* prefix, const char* fmt, va_list args);
+void sl_setLogOutput(Print* out);
+
+#endif
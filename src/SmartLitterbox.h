@@ -3,6 +3,9 @@
 
 #include <Arduino.h>
 #include <vector>
+#include <functional>
+#include <memory>
+#include "SyncCadence.h"
 
 // --- Unified Data Structures ---
 
@@ -40,6 +43,85 @@ struct SL_Status {
     String status_text;         // e.g., "Ready", "Cleaning", "Cat Detected"
 };
 
+// Non-owning view of a stored record. The pointers reference the snapshot the
+// view came from, so a view is only valid while that snapshot is held
+// (records() holds it for the length of the loop).
+struct SL_RecordView {
+    const char* pet_name;
+    int PetId;
+    time_t timestamp;
+    float weight_lbs;
+    float duration_seconds;
+    const char* action;
+    const char* source_device;
+};
+
+#define SL_ROLLUP_MAX_TYPES 8
+
+// One pet's activity for one local day. Older raw records are compacted into
+// these (see DailyRollupStore); event types index DailyRollupStore::eventType().
+// PetId 0 collects a device's events that involve no pet (e.g. clean cycles).
+struct SL_DailyRollup {
+    uint32_t day;               // Local date as YYYYMMDD
+    int PetId;
+    const char* pet_name;       // Owned by the store
+    uint16_t visits;
+    uint16_t weighed;           // Visits that reported a weight
+    float weight_min_lbs;
+    float weight_max_lbs;
+    float weight_sum_lbs;
+    uint32_t duration_seconds;  // Total for the day
+    uint16_t type_counts[SL_ROLLUP_MAX_TYPES];
+
+    float weightMeanLbs() const { return weighed ? weight_sum_lbs / weighed : 0; }
+};
+
+class DailyRollupStore;
+
+// Stored records readable by index, e.g. the records of one published fetch
+class SL_RecordSource {
+public:
+    virtual ~SL_RecordSource() {}
+    virtual size_t recordCount() const = 0;
+    // False for stored entries that are not exposed as unified records
+    virtual bool recordAt(size_t index, SL_RecordView& out) const = 0;
+    // Every stored entry, for rollups: entries recordAt() hides come back
+    // with PetId 0. False only for entries that are not kept at all.
+    virtual bool entryAt(size_t index, SL_RecordView& out) const { return recordAt(index, out); }
+    // Rollups of the records compacted out of this source, published with it
+    virtual const DailyRollupStore* dailyRollups() const { return nullptr; }
+};
+
+class SL_RecordRange;
+
+// Change events, computed after each fetch by diffing against the previous one
+enum class SL_EventType : uint8_t {
+    DEVICE_ONLINE,      // First seen, or back after missing from a fetch
+    DEVICE_OFFLINE,     // Listed before, missing from this fetch
+    STATUS_CHANGED,     // status_text changed (e.g. "Ready" -> "Cleaning")
+    DRAWER_FULL,
+    DRAWER_EMPTIED,
+    LITTER_LOW,         // Dropped below the low-litter threshold
+    LITTER_REFILLED,
+    FAULT,
+    FAULT_CLEARED,
+    NEW_VISIT           // A record not delivered before
+};
+
+// Pointers are only valid during the callback
+struct SL_Event {
+    SL_EventType type;
+    const char* device;             // Status device_name, or the record's source_device
+    const SL_Status* status;        // Current status; nullptr for NEW_VISIT / DEVICE_OFFLINE
+    const SL_Status* previous;      // Status from the last fetch, if any
+    const SL_RecordView* record;    // NEW_VISIT only
+};
+
+// Ingestion callbacks. The view's strings are only valid during the call.
+typedef std::function<void(const SL_RecordView&)> SL_RecordCallback;
+typedef std::function<void(const SL_Status&)> SL_StatusCallback;
+typedef std::function<void(const SL_Event&)> SL_EventCallback;
+
 // --- Abstract Base Class ---
 
 class SmartLitterbox {
@@ -55,9 +137,30 @@ public:
     // Unified Accessors (Must be implemented by children)
     virtual std::vector<SL_Pet> getUnifiedPets() const = 0;
     virtual std::vector<SL_Record> getUnifiedRecords() const = 0;
+
+    // Records of the last published fetch. Each fetch builds its data off to
+    // the side and swaps it in whole, so a held source stays consistent and
+    // alive while later fetches run; readers never wait for a fetch.
+    virtual std::shared_ptr<const SL_RecordSource> recordSource() const = 0;
+    // Allocation-free iteration over one consistent snapshot
+    SL_RecordRange records() const;
+    size_t recordCount() const { return recordSource()->recordCount(); }
     
-    // Unified Status Accessor
+    // Unified Status Accessors
+    // getUnifiedStatus() is the newest status of any device; getUnifiedStatuses()
+    // has the latest status of every device.
     virtual SL_Status getUnifiedStatus() const = 0;
+    virtual std::vector<SL_Status> getUnifiedStatuses() const = 0;
+
+    // Raw records older than this many local days are folded into daily
+    // rollups by the next fetch; 0 (default) keeps everything raw
+    virtual void setRawRetentionDays(int days) = 0;
+    // Daily rollups of records older than the raw retention window, from the
+    // same snapshot as recordSource(); null if the provider keeps none
+    std::shared_ptr<const DailyRollupStore> rollups() const;
+    // Per-pet per-day summaries for [from, to], from rollups for compacted
+    // days and from raw records for recent ones (see DailyRollupStore.h)
+    std::vector<SL_DailyRollup> getDailySummaries(time_t from, time_t to) const;
     
     // Get a specific pet by ID
     SL_Pet getPetById(String id) const {
@@ -101,7 +204,105 @@ public:
         return filtered;
     }
 
+    // onRecord() is called for each new record while a fetch is parsing,
+    // newest first per source; records delivered by an earlier fetch are not
+    // delivered again. onStatus() gets each device's current status once per
+    // fetch that updates it.
+    void onRecord(SL_RecordCallback callback) { _on_record = callback; }
+    void onStatus(SL_StatusCallback callback) { _on_status = callback; }
+    // Typed changes (see SL_EventType) instead of comparing snapshots yourself
+    void onEvent(SL_EventCallback callback) { _on_event = callback; }
+
+    // Refresh intervals per data class; fetchAllData() only issues the
+    // requests of classes that are due. All intervals default to 0 (every call).
+    SyncCadence& cadence() { return _cadence; }
+    // Force the next fetchAllData() to refresh the class (or everything)
+    void invalidate(SL_DataClass cls) { _cadence.invalidate(cls); }
+    void invalidate() { _cadence.invalidate(); }
+
+    // false: records only go to onRecord() and are not kept, so memory does
+    // not depend on the fetch window (records() stays empty, no rollups)
+    void setStoreRecords(bool enabled) { _store_records = enabled; }
+    bool storeRecords() const { return _store_records; }
+
     virtual void setDebug(bool enabled) = 0;
+    // SL_LOG_LEVEL_NONE .. SL_LOG_LEVEL_DEBUG (see SL_Log.h); setDebug(true) means DEBUG
+    virtual void setLogLevel(uint8_t level) = 0;
+
+protected:
+    void _emitRecord(const SL_RecordView& r) const {
+        if (_on_record) _on_record(r);
+        if (_on_event) _on_event(SL_Event{SL_EventType::NEW_VISIT, r.source_device, nullptr, nullptr, &r});
+    }
+    void _emitStatus(const SL_Status& s) const { if (_on_status) _on_status(s); }
+
+    SL_RecordCallback _on_record;
+    SL_StatusCallback _on_status;
+    SL_EventCallback _on_event;
+    SyncCadence _cadence;
+    bool _store_records = true;
 };
 
+// --- Record Iteration ---
+// for (const SL_RecordView& r : box.records()) { ... }
+
+class SL_RecordIterator {
+public:
+    SL_RecordIterator(const SL_RecordSource* source, size_t index) : _source(source), _index(index) { _settle(); }
+
+    const SL_RecordView& operator*() const { return _view; }
+    const SL_RecordView* operator->() const { return &_view; }
+    SL_RecordIterator& operator++() { _index++; _settle(); return *this; }
+    bool operator==(const SL_RecordIterator& other) const { return _index == other._index; }
+    bool operator!=(const SL_RecordIterator& other) const { return _index != other._index; }
+
+private:
+    // Skip forward to the next exposed record (or end)
+    void _settle() {
+        size_t count = _source->recordCount();
+        while (_index < count && !_source->recordAt(_index, _view)) _index++;
+        if (_index > count) _index = count;
+    }
+
+    const SL_RecordSource* _source;
+    size_t _index;
+    SL_RecordView _view;
+};
+
+class SL_RecordRange {
+public:
+    // Holds the snapshot for as long as the range lives
+    explicit SL_RecordRange(std::shared_ptr<const SL_RecordSource> source) : _hold(source), _source(source.get()) {}
+    // Caller keeps source alive
+    explicit SL_RecordRange(const SL_RecordSource& source) : _source(&source) {}
+
+    SL_RecordIterator begin() const { return SL_RecordIterator(_source, 0); }
+    SL_RecordIterator end() const { return SL_RecordIterator(_source, _source->recordCount()); }
+
+private:
+    std::shared_ptr<const SL_RecordSource> _hold;
+    const SL_RecordSource* _source;
+};
+
+inline SL_RecordRange SmartLitterbox::records() const { return SL_RecordRange(recordSource()); }
+
+// Needs the types above, so it comes last
+#include "DailyRollupStore.h"
+
+inline std::shared_ptr<const DailyRollupStore> SmartLitterbox::rollups() const {
+    std::shared_ptr<const SL_RecordSource> source = recordSource();
+    const DailyRollupStore* store = source->dailyRollups();
+    return store ? std::shared_ptr<const DailyRollupStore>(source, store) : nullptr;
+}
+
+// Rollups and raw records from one snapshot, so a compaction that runs
+// meanwhile can neither drop a day nor count it twice
+inline std::vector<SL_DailyRollup> SmartLitterbox::getDailySummaries(time_t from, time_t to) const {
+    std::vector<SL_DailyRollup> out;
+    std::shared_ptr<const SL_RecordSource> source = recordSource();
+    const DailyRollupStore* store = source->dailyRollups();
+    if (store) store->query(*source, from, to, out);
+    return out;
+}
+
 #endif
\ No newline at end of file
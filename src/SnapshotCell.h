@@ -0,0 +1,33 @@
+#ifndef SnapshotCell_h
+#define SnapshotCell_h
+
+#include <memory>
+
+// Current version of some immutable data, shared RCU-style between one writer
+// and any number of reader tasks. The writer builds a new T off to the side
+// and publish()es it with a single pointer swap; load() returns a counted
+// reference to whichever version was current, which stays valid and
+// unchanged for as long as the reader holds it. A retired version is freed
+// when its last reader lets go.
+//
+// Readers never wait for a fetch, but they are not wait-free: libstdc++
+// implements the shared_ptr atomics with a small pool of mutexes, so load()
+// and publish() briefly lock to copy the pointer and its count. The lock is
+// never held while data is built, so a reader waits at most for another
+// task's pointer copy.
+
+template <typename T>
+class SnapshotCell {
+public:
+    typedef std::shared_ptr<const T> Ptr;
+
+    explicit SnapshotCell(Ptr initial = Ptr()) : _current(std::move(initial)) {}
+
+    Ptr load() const { return std::atomic_load(&_current); }
+    void publish(Ptr next) { std::atomic_store(&_current, std::move(next)); }
+
+private:
+    Ptr _current;
+};
+
+#endif
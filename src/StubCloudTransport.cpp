@@ -0,0 +1,421 @@
+#include "StubCloudTransport.h"
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#if defined(ESP32)
+#include "esp_pthread.h"
+#endif
+
+// Timer thread shared by all stubs: runs each job when its time comes
+class StubNetwork {
+public:
+    static StubNetwork& shared()
+    {
+        static StubNetwork instance;
+        return instance;
+    }
+
+    void at(unsigned long due_ms, std::function<void()> job)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _jobs.push(Job{due_ms, _seq++, std::move(job)});
+        _cv.notify_one();
+    }
+
+private:
+    struct Job {
+        unsigned long due_ms;
+        unsigned long seq;
+        std::function<void()> run;
+        bool operator>(const Job& other) const
+        {
+            long d = (long)(due_ms - other.due_ms);
+            return d != 0 ? d > 0 : seq > other.seq;
+        }
+    };
+
+    StubNetwork() : _seq(0)
+    {
+#if defined(ESP32)
+        // Jobs build and parse whole responses; the default pthread stack is too small
+        esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+        cfg.stack_size = 12288;
+        esp_pthread_set_cfg(&cfg);
+#endif
+        std::thread([this] { _loop(); }).detach();
+    }
+
+    void _loop()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true)
+        {
+            if (_jobs.empty())
+            {
+                _cv.wait(lock);
+                continue;
+            }
+            long wait_ms = (long)(_jobs.top().due_ms - millis());
+            if (wait_ms > 0)
+            {
+                _cv.wait_for(lock, std::chrono::milliseconds(wait_ms));
+                continue;
+            }
+            Job job = _jobs.top();
+            _jobs.pop();
+            lock.unlock();
+            job.run();
+            lock.lock();
+        }
+    }
+
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::priority_queue<Job, std::vector<Job>, std::greater<Job>> _jobs;
+    unsigned long _seq;
+};
+#include "DailyRollupStore.h"
+#include <algorithm>
+
+// base64 of {"mid":"stub-user"}; WhiskerApi only reads the JWT payload
+static const char* STUB_ID_TOKEN = "eyJhbGciOiJub25lIn0.eyJtaWQiOiJzdHViLXVzZXIifQ==.stub";
+
+StubCloudTransport::StubCloudTransport()
+    : _household{2, 3, 30, 4.0f},
+      _seed(1),
+      _latency_ms(0),
+      _jitter_ms(0),
+      _tail_permille(0),
+      _tail_ms(0),
+      _requests(0),
+      _unknown(0)
+{
+}
+
+void StubCloudTransport::setLatency(unsigned long latency_ms, unsigned long jitter_ms)
+{
+    _latency_ms = latency_ms;
+    _jitter_ms = jitter_ms;
+}
+
+void StubCloudTransport::setTailLatency(unsigned permille, unsigned long extra_ms)
+{
+    _tail_permille = permille;
+    _tail_ms = extra_ms;
+}
+
+int StubCloudTransport::send(const HttpRequest& req, HttpResponse& resp)
+{
+    unsigned long sent = millis();
+    delay(_nextLatency());
+    return _respond(req, resp, sent);
+}
+
+void StubCloudTransport::submit(const HttpRequest& req, HttpCompletion done)
+{
+    unsigned long wait_ms = _nextLatency();
+    if (wait_ms == 0)
+    {
+        HttpTransport::submit(req, done);
+        return;
+    }
+    unsigned long sent = millis();
+    StubNetwork::shared().at(sent + wait_ms, [this, req, done, sent]() {
+        HttpResponse resp;
+        _respond(req, resp, sent);
+        done(resp);
+    });
+}
+
+// --- Private Helper Methods ---
+
+unsigned long StubCloudTransport::_nextLatency()
+{
+    unsigned long n = ++_requests;
+    unsigned long wait_ms = _latency_ms;
+    if (_jitter_ms) wait_ms += _hash(n, 0, 0) % (_jitter_ms + 1);
+    if (_tail_permille && _hash(n, 1, 0) % 1000 < _tail_permille) wait_ms += _tail_ms;
+    return wait_ms;
+}
+
+int StubCloudTransport::_respond(const HttpRequest& req, HttpResponse& resp, unsigned long sent)
+{
+    resp.reset();
+    JsonDocument doc;
+    resp.status = _route(req, doc);
+    serializeJson(doc, resp.body);
+    resp.wire_bytes = resp.body_bytes = resp.body.length();
+    resp.header_ms = (long)(millis() - sent);
+    deliverBody(req, resp);
+    return resp.status;
+}
+
+int StubCloudTransport::_route(const HttpRequest& req, JsonDocument& out)
+{
+    const String& url = req.url;
+    String body((const char*)req.body, req.body_length);
+
+    // PetKit: every response is wrapped in "result"
+    if (url.endsWith("/v1/regionservers"))
+    {
+        JsonObject server = out["result"]["list"].add<JsonObject>();
+        server["id"] = "US";
+        server["name"] = "United States";
+        server["gateway"] = "https://gateway.petkit.stub/latest/";
+        return 200;
+    }
+    if (url.endsWith("/user/login"))
+    {
+        out["result"]["session"]["id"] = "stub-session";
+        return 200;
+    }
+    if (url.endsWith("/group/family/list"))
+    {
+        _petkitFamily(out);
+        return 200;
+    }
+    if (url.endsWith("/getDeviceRecord"))
+    {
+        _petkitRecords(body, out);
+        return 200;
+    }
+
+    // Whisker
+    if (url.indexOf("cognito-idp") >= 0)
+    {
+        _whiskerLogin(out);
+        return 200;
+    }
+    if (url.endsWith("/graphql"))
+    {
+        JsonDocument q;
+        if (deserializeJson(q, body)) return 400;
+        String query = q["query"].as<String>();
+        JsonObject vars = q["variables"];
+        int limit = vars["limit"] ? vars["limit"].as<int>() : 10;
+
+        if (query.indexOf("getPetsByUser") >= 0) _whiskerPets(out);
+        else if (query.indexOf("getWeightHistoryByPetId") >= 0) _whiskerWeights(vars["petId"].as<String>().c_str(), limit, out);
+        else if (query.indexOf("getLitterRobot4ByUser") >= 0) _whiskerRobots(out);
+        else if (query.indexOf("getLitterRobot4Activity") >= 0) _whiskerActivity(vars["serial"].as<String>().c_str(), limit, out);
+        else return 400;
+        return 200;
+    }
+
+    _unknown++;
+    return 404;
+}
+
+void StubCloudTransport::_petkitFamily(JsonDocument& out)
+{
+    JsonObject account = out["result"].add<JsonObject>();
+    JsonArray pets = account["petList"].to<JsonArray>();
+    for (int c = 0; c < _household.cats; c++)
+    {
+        JsonObject p = pets.add<JsonObject>();
+        p["petId"] = 1000 + c;
+        p["petName"] = String("Cat ") + String(c);
+    }
+    JsonArray devices = account["deviceList"].to<JsonArray>();
+    for (int d = 0; d < _household.devices; d++)
+    {
+        JsonObject dev = devices.add<JsonObject>();
+        dev["deviceId"] = String("stub-") + String(d);
+        dev["deviceType"] = "T4";
+        dev["deviceName"] = String("Box ") + String(d);
+    }
+}
+
+void StubCloudTransport::_petkitRecords(const String& form, JsonDocument& out)
+{
+    JsonArray records = out["result"].to<JsonArray>();
+
+    // day=YYYYMMDD (T3) or date=YYYYMMDD, plus deviceId=stub-N
+    int at = form.indexOf("date=");
+    at = (at >= 0) ? at + 5 : form.indexOf("day=") + 4;
+    int dev_at = form.indexOf("deviceId=stub-");
+    if (at < 4 || dev_at < 0) return;
+    int device = form.substring(dev_at + 14).toInt();
+
+    long ymd = form.substring(at, at + 8).toInt();
+    struct tm t = {};
+    t.tm_year = ymd / 10000 - 1900;
+    t.tm_mon = (ymd / 100) % 100 - 1;
+    t.tm_mday = ymd % 100;
+    t.tm_isdst = -1;
+    time_t today = DailyRollupStore::dayStart(time(nullptr), 0);
+    int days_ago = (int)((today - mktime(&t) + 43200) / 86400);
+
+    std::vector<Visit> visits;
+    _visitsOn(days_ago, visits);
+    for (const auto& v : visits)
+    {
+        if (v.device != device) continue;
+        JsonObject r = records.add<JsonObject>();
+        r["enumEventType"] = 10;
+        r["timestamp"] = (long)v.timestamp;
+        r["petId"] = 1000 + v.cat;
+        r["petName"] = String("Cat ") + String(v.cat);
+        r["content"]["petWeight"] = (int)(v.weight_lbs / 0.00220462);
+        r["content"]["timeIn"] = (long)v.timestamp;
+        r["content"]["timeOut"] = (long)v.timestamp + v.duration_s;
+        JsonObject status = r["subContent"].add<JsonObject>()["content"].to<JsonObject>();
+        status["litterPercent"] = 100 - (int)(_hash(device, v.timestamp, 1) % 60);
+        status["boxFull"] = false;
+        status["sandLack"] = false;
+    }
+}
+
+void StubCloudTransport::_whiskerLogin(JsonDocument& out)
+{
+    out["AuthenticationResult"]["IdToken"] = STUB_ID_TOKEN;
+    out["AuthenticationResult"]["AccessToken"] = "stub-access";
+}
+
+void StubCloudTransport::_whiskerPets(JsonDocument& out)
+{
+    JsonArray pets = out["data"]["getPetsByUser"].to<JsonArray>();
+    for (int c = 0; c < _household.cats; c++)
+    {
+        JsonObject p = pets.add<JsonObject>();
+        p["petId"] = String("pet-") + String(c);
+        p["name"] = String("Cat ") + String(c);
+        p["weight"] = 8 + c % 5;
+    }
+}
+
+void StubCloudTransport::_whiskerWeights(const char* pet_id, int limit, JsonDocument& out)
+{
+    JsonArray history = out["data"]["getWeightHistoryByPetId"].to<JsonArray>();
+    if (strncmp(pet_id, "pet-", 4) != 0) return;
+    int cat = atoi(pet_id + 4);
+
+    std::vector<Visit> visits;
+    char ts[24];
+    int n = 0;
+    for (int day = 0; day < _household.days && n < limit; day++)
+    {
+        _visitsOn(day, visits);
+        for (auto it = visits.rbegin(); it != visits.rend() && n < limit; ++it)
+        {
+            if (it->cat != cat) continue;
+            JsonObject w = history.add<JsonObject>();
+            w["weight"] = it->weight_lbs;
+            _formatTime(it->timestamp, "%Y-%m-%dT%H:%M:%S", ts, sizeof(ts));
+            w["timestamp"] = ts;
+            n++;
+        }
+    }
+}
+
+void StubCloudTransport::_whiskerRobots(JsonDocument& out)
+{
+    JsonArray robots = out["data"]["getLitterRobot4ByUser"].to<JsonArray>();
+    time_t now = time(nullptr);
+    for (int d = 0; d < _household.devices; d++)
+    {
+        uint32_t h = _hash(d, now / 3600, 2);
+        JsonObject r = robots.add<JsonObject>();
+        r["serial"] = String("LR4-") + String(d);
+        r["name"] = String("Robot ") + String(d);
+        r["litterLevel"] = 440 + (int)(h % 60);
+        r["DFILevelPercent"] = (int)((h >> 8) % 100);
+        r["isDFIFull"] = false;
+        r["robotStatus"] = "ROBOT_IDLE";
+    }
+}
+
+void StubCloudTransport::_whiskerActivity(const char* serial, int limit, JsonDocument& out)
+{
+    JsonArray activity = out["data"]["getLitterRobot4Activity"].to<JsonArray>();
+    if (strncmp(serial, "LR4-", 4) != 0) return;
+    int device = atoi(serial + 4);
+    time_t now = time(nullptr);
+
+    std::vector<Visit> visits;
+    char ts[24];
+    int n = 0;
+    for (int day = 0; day < _household.days && n < limit; day++)
+    {
+        _visitsOn(day, visits);
+        for (auto it = visits.rbegin(); it != visits.rend() && n < limit; ++it)
+        {
+            if (it->device != device) continue;
+
+            // Cycle completes ~7 minutes after the cat leaves
+            time_t cycle = it->timestamp + it->duration_s + 420;
+            if (cycle <= now)
+            {
+                JsonObject a = activity.add<JsonObject>();
+                _formatTime(cycle, "%Y-%m-%d %H:%M:%S", ts, sizeof(ts));
+                a["timestamp"] = ts;
+                bool full = _hash(device, it->timestamp, 3) % 20 == 0;
+                a["value"] = full ? "DFIFullFlagOn" : "robotCycleStatusIdle";
+                n++;
+            }
+            if (n < limit)
+            {
+                JsonObject a = activity.add<JsonObject>();
+                _formatTime(it->timestamp, "%Y-%m-%d %H:%M:%S", ts, sizeof(ts));
+                a["timestamp"] = ts;
+                a["value"] = "catWeight";
+                a["actionValue"] = it->weight_lbs;
+                n++;
+            }
+        }
+    }
+}
+
+void StubCloudTransport::_visitsOn(int days_ago, std::vector<Visit>& out) const
+{
+    out.clear();
+    if (days_ago < 0 || days_ago >= _household.days || _household.devices <= 0) return;
+
+    time_t now = time(nullptr);
+    time_t start = DailyRollupStore::dayStart(now, days_ago);
+    uint32_t day = (uint32_t)(start / 86400);
+
+    int whole = (int)_household.visits_per_day;
+    uint32_t frac = (uint32_t)((_household.visits_per_day - whole) * 1000);
+
+    for (int c = 0; c < _household.cats; c++)
+    {
+        int n = whole + ((_hash(c, day, 0xFFFF) % 1000) < frac ? 1 : 0);
+        for (int j = 0; j < n; j++)
+        {
+            uint32_t h = _hash(c, day, j);
+            Visit v;
+            v.cat = c;
+            v.timestamp = start + h % 86400;
+            if (v.timestamp > now) continue;
+            v.device = (h >> 4) % _household.devices;
+            v.weight_lbs = 8 + c % 5 + (float)((h >> 8) % 100) / 100.0f - 0.5f;
+            v.duration_s = 30 + (h >> 16) % 150;
+            out.push_back(v);
+        }
+    }
+    std::sort(out.begin(), out.end(), [](const Visit& a, const Visit& b) { return a.timestamp < b.timestamp; });
+}
+
+uint32_t StubCloudTransport::_hash(uint32_t a, uint32_t b, uint32_t c) const
+{
+    // Small avalanche mix; deterministic across platforms for a given seed
+    uint32_t h = _seed ^ 0x9E3779B9u;
+    for (uint32_t v : {a, b, c})
+    {
+        h ^= v + 0x7F4A7C15u + (h << 6) + (h >> 2);
+        h ^= h >> 16;
+        h *= 0x85EBCA6Bu;
+        h ^= h >> 13;
+    }
+    return h;
+}
+
+void StubCloudTransport::_formatTime(time_t ts, const char* fmt, char* buf, size_t size)
+{
+    struct tm t;
+    localtime_r(&ts, &t);
+    strftime(buf, size, fmt, &t);
+}
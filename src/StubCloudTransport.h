@@ -0,0 +1,79 @@
+#ifndef StubCloudTransport_h
+#define StubCloudTransport_h
+
+#include "HttpTransport.h"
+#include <ArduinoJson.h>
+#include <atomic>
+#include <vector>
+
+// In-process stand-in for the PetKit passport / gateway and the Whisker
+// Cognito / GraphQL endpoints, for soak and scale testing. It serves a
+// synthetic household: every visit is derived from a hash of (cat, day,
+// visit), so repeated syncs see the same history, and visits appear as the
+// system clock passes them. Endpoints are matched by path, so any host works.
+// submit() does not block: one shared thread, standing in for the network,
+// answers every stub's requests once their latency has passed, so many
+// requests can be outstanding at once as with a real asynchronous engine.
+
+class StubCloudTransport : public HttpTransport {
+public:
+    struct Household {
+        int devices;            // PetKit boxes, and as many Litter-Robots
+        int cats;
+        int days;               // History depth
+        float visits_per_day;   // Per cat
+    };
+
+    StubCloudTransport();
+
+    void setHousehold(const Household& household) { _household = household; }
+    const Household& household() const { return _household; }
+    void setSeed(uint32_t seed) { _seed = seed; }
+    // Fixed latency plus uniform jitter per request
+    void setLatency(unsigned long latency_ms, unsigned long jitter_ms = 0);
+    // permille of requests stall for extra_ms on top, like a slow server
+    void setTailLatency(unsigned permille, unsigned long extra_ms);
+
+    int send(const HttpRequest& req, HttpResponse& resp) override;
+    void submit(const HttpRequest& req, HttpCompletion done) override;
+
+    unsigned long requestCount() const { return _requests.load(); }
+    unsigned long unknownCount() const { return _unknown.load(); }
+
+private:
+    struct Visit {
+        int cat;
+        int device;
+        time_t timestamp;
+        float weight_lbs;
+        int duration_s;
+    };
+
+    unsigned long _nextLatency();
+    int _respond(const HttpRequest& req, HttpResponse& resp, unsigned long sent);
+    int _route(const HttpRequest& req, JsonDocument& out);
+
+    void _petkitFamily(JsonDocument& out);
+    void _petkitRecords(const String& form, JsonDocument& out);
+    void _whiskerLogin(JsonDocument& out);
+    void _whiskerPets(JsonDocument& out);
+    void _whiskerWeights(const char* pet_id, int limit, JsonDocument& out);
+    void _whiskerRobots(JsonDocument& out);
+    void _whiskerActivity(const char* serial, int limit, JsonDocument& out);
+
+    // Visits on the day `days_ago` days before today (oldest first), up to now
+    void _visitsOn(int days_ago, std::vector<Visit>& out) const;
+    uint32_t _hash(uint32_t a, uint32_t b, uint32_t c) const;
+    static void _formatTime(time_t ts, const char* fmt, char* buf, size_t size);
+
+    Household _household;
+    uint32_t _seed;
+    unsigned long _latency_ms;
+    unsigned long _jitter_ms;
+    unsigned _tail_permille;
+    unsigned long _tail_ms;
+    std::atomic<unsigned long> _requests;
+    std::atomic<unsigned long> _unknown;
+};
+
+#endif
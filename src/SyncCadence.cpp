@@ -0,0 +1,57 @@
+#include "SyncCadence.h"
+#include <limits>
+
+SyncCadence::SyncCadence()
+    : _aligned(true)
+{
+    for (int i = 0; i < SL_DATA_CLASS_COUNT; i++)
+    {
+        _interval_s[i] = 0;
+        _last[i] = 0;
+    }
+}
+
+void SyncCadence::setInterval(SL_DataClass cls, uint32_t seconds)
+{
+    _interval_s[(int)cls] = seconds;
+}
+
+void SyncCadence::invalidate()
+{
+    for (int i = 0; i < SL_DATA_CLASS_COUNT; i++) _last[i] = 0;
+}
+
+bool SyncCadence::due(SL_DataClass cls, time_t now) const
+{
+    return now >= _dueAt((int)cls);
+}
+
+void SyncCadence::markDone(SL_DataClass cls, time_t now)
+{
+    _last[(int)cls] = now;
+}
+
+time_t SyncCadence::nextDue(time_t now) const
+{
+    time_t next = 0;
+    for (int i = 0; i < SL_DATA_CLASS_COUNT; i++)
+    {
+        time_t at = _dueAt(i);
+        if (next == 0 || at < next) next = at;
+    }
+    return next < now ? now : next;
+}
+
+// --- Private Helper Methods ---
+
+time_t SyncCadence::_dueAt(int cls) const
+{
+    time_t last = _last[cls];
+    uint32_t interval = _interval_s[cls];
+    if (last == 0 || interval == 0) return last; // Due immediately
+    if (interval == SL_CADENCE_ON_DEMAND) return std::numeric_limits<time_t>::max();
+
+    // Aligned: the first slot boundary after the last fetch
+    if (_aligned) return (last / interval + 1) * interval;
+    return last + interval;
+}
@@ -0,0 +1,54 @@
+#ifndef SyncCadence_h
+#define SyncCadence_h
+
+#include <Arduino.h>
+#include <time.h>
+
+// Data a provider fetches, by how often it changes
+enum class SL_DataClass {
+    PETS,       // Pets and the device list
+    RECORDS,    // Visit / activity history
+    STATUS      // Current device status
+};
+
+#define SL_DATA_CLASS_COUNT 3
+
+// Interval for a class that is refreshed only after invalidate(), for callers
+// that track freshness themselves (see LitterboxCache)
+#define SL_CADENCE_ON_DEMAND 0xFFFFFFFFu
+
+// Independent refresh intervals per data class, on the wall clock (time()),
+// so state stays meaningful across light sleep and after NTP sync.
+//
+// With alignment on (default) a class falls due at each multiple of its
+// interval since the epoch rather than `interval` after its last fetch.
+// Providers given the same intervals therefore come due together, and one
+// radio-on window serves all of them; nextDue() says when to wake.
+
+class SyncCadence {
+public:
+    SyncCadence();
+
+    // 0 means refresh on every call
+    void setInterval(SL_DataClass cls, uint32_t seconds);
+    uint32_t interval(SL_DataClass cls) const { return _interval_s[(int)cls]; }
+    void setAligned(bool aligned) { _aligned = aligned; }
+
+    bool due(SL_DataClass cls, time_t now) const;
+    void markDone(SL_DataClass cls, time_t now);
+
+    void invalidate(SL_DataClass cls) { _last[(int)cls] = 0; }
+    void invalidate();
+
+    // Earliest time any class is due (now if one already is)
+    time_t nextDue(time_t now) const;
+
+private:
+    time_t _dueAt(int cls) const;
+
+    uint32_t _interval_s[SL_DATA_CLASS_COUNT];
+    time_t _last[SL_DATA_CLASS_COUNT];  // 0 = never / invalidated
+    bool _aligned;
+};
+
+#endif
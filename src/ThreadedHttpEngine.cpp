@@ -0,0 +1,68 @@
+#include "ThreadedHttpEngine.h"
+
+#if defined(ESP32)
+#include "esp_pthread.h"
+#endif
+
+ThreadedHttpEngine::ThreadedHttpEngine(HttpTransport& inner, int workers, size_t stack_size)
+    : _inner(inner), _closed(false)
+{
+#if defined(ESP32)
+    // std::thread is a pthread on a FreeRTOS task; the default stack is too small for TLS
+    esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+    cfg.stack_size = stack_size;
+    cfg.thread_name = "sl_http";
+    esp_pthread_set_cfg(&cfg);
+#else
+    (void)stack_size;
+#endif
+    if (workers < 1) workers = 1;
+    for (int i = 0; i < workers; i++) _threads.emplace_back([this] { _run(); });
+}
+
+ThreadedHttpEngine::~ThreadedHttpEngine()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _closed = true;
+    }
+    _cv.notify_all();
+    for (auto& t : _threads) t.join();
+}
+
+void ThreadedHttpEngine::submit(const HttpRequest& req, HttpCompletion done)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _queue.push_back(Job{req, std::move(done)});
+    }
+    _cv.notify_one();
+}
+
+size_t ThreadedHttpEngine::queued()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _queue.size();
+}
+
+// --- Private Helper Methods ---
+
+void ThreadedHttpEngine::_run()
+{
+    while (true)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cv.wait(lock, [this] { return _closed || !_queue.empty(); });
+            // Drain what was queued before shutting down
+            if (_queue.empty()) return;
+            job = std::move(_queue.front());
+            _queue.pop_front();
+        }
+
+        HttpResponse resp;
+        _inner.send(job.req, resp);
+        job.done(resp);
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef ThreadedHttpEngine_h
+#define ThreadedHttpEngine_h
+
+#include "HttpTransport.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Asynchronous engine over any blocking transport: submit() queues the request
+// and returns, and a small pool of worker threads runs the exchanges. On the
+// ESP32, where HTTPClient and the TLS stack are blocking, this is how several
+// requests are kept in flight (each worker is a FreeRTOS task; stack_size
+// must cover a TLS handshake). The inner transport must be safe to call from
+// several threads at once, which Esp32HttpTransport is.
+class ThreadedHttpEngine : public HttpTransport {
+public:
+    ThreadedHttpEngine(HttpTransport& inner, int workers = 2, size_t stack_size = 12288);
+    ~ThreadedHttpEngine();
+
+    // Blocking exchanges run on the caller's thread
+    int send(const HttpRequest& req, HttpResponse& resp) override { return _inner.send(req, resp); }
+    void submit(const HttpRequest& req, HttpCompletion done) override;
+    bool isConnected() override { return _inner.isConnected(); }
+
+    size_t queued();
+
+private:
+    struct Job {
+        HttpRequest req;
+        HttpCompletion done;
+    };
+
+    void _run();
+
+    HttpTransport& _inner;
+    std::vector<std::thread> _threads;
+    std::deque<Job> _queue;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    bool _closed;
+};
+
+#endif
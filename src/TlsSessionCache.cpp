@@ -0,0 +1,264 @@
+#include "TlsSessionCache.h"
+#include <stdio.h>
+
+TlsSessionCache::TlsSessionCache() : _next_slot(0)
+{
+    for (auto& e : _entries)
+    {
+        e.host[0] = 0;
+        e.data = nullptr;
+        e.length = 0;
+    }
+    resetStats();
+}
+
+TlsSessionCache::~TlsSessionCache()
+{
+    clear();
+}
+
+TlsSessionCache& TlsSessionCache::shared()
+{
+    static TlsSessionCache instance;
+    return instance;
+}
+
+bool TlsSessionCache::apply(const char* host, mbedtls_ssl_context* ssl, unsigned char* master)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    Entry* e = _find(host);
+    if (!e) return false;
+
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+    bool ok = mbedtls_ssl_session_load(&session, e->data, e->length) == 0 &&
+              mbedtls_ssl_set_session(ssl, &session) == 0;
+    if (ok) memcpy(master, e->master, SL_TLS_MASTER_LEN);
+    mbedtls_ssl_session_free(&session);
+
+    if (!ok)
+    {
+        // Stale format (e.g. restored from an older firmware); forget it
+        free(e->data);
+        e->data = nullptr;
+        e->host[0] = 0;
+    }
+    return ok;
+}
+
+void TlsSessionCache::store(const char* host, const mbedtls_ssl_context* ssl, const unsigned char* master)
+{
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+    if (mbedtls_ssl_get_session(ssl, &session) != 0)
+    {
+        mbedtls_ssl_session_free(&session);
+        return;
+    }
+
+    size_t length = 0;
+    mbedtls_ssl_session_save(&session, nullptr, 0, &length);
+    uint8_t* data = length ? (uint8_t*)malloc(length) : nullptr;
+    if (data && mbedtls_ssl_session_save(&session, data, length, &length) == 0)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _put(host, data, length, master);
+    }
+    free(data);
+    mbedtls_ssl_session_free(&session);
+}
+
+void TlsSessionCache::remove(const char* host)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    Entry* e = _find(host);
+    if (!e) return;
+    free(e->data);
+    e->data = nullptr;
+    e->length = 0;
+    e->host[0] = 0;
+}
+
+void TlsSessionCache::clear()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto& e : _entries)
+    {
+        free(e.data);
+        e.data = nullptr;
+        e.length = 0;
+        e.host[0] = 0;
+    }
+}
+
+void TlsSessionCache::recordHandshake(unsigned long ms, bool resumed)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (resumed)
+    {
+        _stats.resumed_count++;
+        _stats.resumed_ms += ms;
+    }
+    else
+    {
+        _stats.full_count++;
+        _stats.full_ms += ms;
+    }
+}
+
+TlsSessionCache::Stats TlsSessionCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
+
+void TlsSessionCache::resetStats()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stats = Stats{0, 0, 0, 0};
+}
+
+void TlsSessionCache::printStats(Print& out) const
+{
+    Stats s = stats();
+    char line[128];
+    snprintf(line, sizeof(line), "TLS handshakes: full %lu (avg %lu ms), resumed %lu (avg %lu ms)",
+             s.full_count, s.full_count ? s.full_ms / s.full_count : 0,
+             s.resumed_count, s.resumed_count ? s.resumed_ms / s.resumed_count : 0);
+    out.println(line);
+}
+
+// --- Persistence ---
+
+size_t TlsSessionCache::save(uint8_t* buf, size_t capacity) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    size_t pos = 0;
+    for (const auto& e : _entries)
+    {
+        if (!e.data) continue;
+        size_t host_len = strlen(e.host);
+        size_t needed = 1 + host_len + 2 + e.length + SL_TLS_MASTER_LEN;
+        if (pos + needed > capacity || e.length > 0xFFFF) continue;
+
+        buf[pos++] = (uint8_t)host_len;
+        memcpy(buf + pos, e.host, host_len);
+        pos += host_len;
+        buf[pos++] = e.length >> 8;
+        buf[pos++] = e.length & 0xFF;
+        memcpy(buf + pos, e.data, e.length);
+        pos += e.length;
+        memcpy(buf + pos, e.master, SL_TLS_MASTER_LEN);
+        pos += SL_TLS_MASTER_LEN;
+    }
+    return pos;
+}
+
+bool TlsSessionCache::restore(const uint8_t* buf, size_t length)
+{
+    // Validate the whole buffer first so a truncated one leaves no partial entries
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (int pass = 0; pass < 2; pass++)
+    {
+        size_t pos = 0;
+        char host[sizeof(_entries[0].host)];
+        while (pos < length)
+        {
+            size_t host_len = buf[pos++];
+            if (host_len >= sizeof(host) || pos + host_len + 2 > length) return false;
+            memcpy(host, buf + pos, host_len);
+            host[host_len] = 0;
+            pos += host_len;
+
+            size_t len = ((size_t)buf[pos] << 8) | buf[pos + 1];
+            pos += 2;
+            if (pos + len + SL_TLS_MASTER_LEN > length) return false;
+            if (pass == 1) _put(host, buf + pos, len, buf + pos + len);
+            pos += len + SL_TLS_MASTER_LEN;
+        }
+    }
+    return true;
+}
+
+bool TlsSessionCache::saveToFile(const char* path) const
+{
+    size_t capacity = 0;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (const auto& e : _entries)
+        {
+            if (e.data) capacity += 1 + strlen(e.host) + 2 + e.length + SL_TLS_MASTER_LEN;
+        }
+    }
+    uint8_t* buf = (uint8_t*)malloc(capacity ? capacity : 1);
+    if (!buf) return false;
+    size_t n = save(buf, capacity);
+
+    FILE* f = fopen(path, "wb");
+    bool ok = f && fwrite(buf, 1, n, f) == n;
+    if (f) fclose(f);
+    free(buf);
+    return ok;
+}
+
+bool TlsSessionCache::loadFromFile(const char* path)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    bool ok = false;
+    uint8_t* buf = size > 0 ? (uint8_t*)malloc(size) : nullptr;
+    if (buf && fread(buf, 1, size, f) == (size_t)size) ok = restore(buf, size);
+    free(buf);
+    fclose(f);
+    return ok;
+}
+
+// --- Private Helper Methods ---
+
+TlsSessionCache::Entry* TlsSessionCache::_find(const char* host)
+{
+    for (auto& e : _entries)
+    {
+        if (e.data && strcmp(e.host, host) == 0) return &e;
+    }
+    return nullptr;
+}
+
+void TlsSessionCache::_put(const char* host, const uint8_t* data, size_t length, const uint8_t* master)
+{
+    if (strlen(host) >= sizeof(_entries[0].host)) return;
+
+    Entry* e = _find(host);
+    if (!e)
+    {
+        for (auto& slot : _entries)
+        {
+            if (!slot.data)
+            {
+                e = &slot;
+                break;
+            }
+        }
+    }
+    if (!e)
+    {
+        // Full: evict round-robin
+        e = &_entries[_next_slot];
+        _next_slot = (_next_slot + 1) % SL_TLS_CACHE_HOSTS;
+    }
+
+    uint8_t* copy = (uint8_t*)malloc(length);
+    if (!copy) return;
+    memcpy(copy, data, length);
+
+    free(e->data);
+    strcpy(e->host, host);
+    e->data = copy;
+    e->length = length;
+    if (master) memcpy(e->master, master, SL_TLS_MASTER_LEN);
+    else memset(e->master, 0, SL_TLS_MASTER_LEN);
+}
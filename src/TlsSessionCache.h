@@ -0,0 +1,70 @@
+#ifndef TlsSessionCache_h
+#define TlsSessionCache_h
+
+#include <Arduino.h>
+#include "mbedtls/version.h"
+#include "mbedtls/ssl.h"
+#include <mutex>
+
+// Per-host store of serialized mbedTLS sessions (session IDs and tickets), so
+// later connections to the same host can do an abbreviated handshake instead
+// of the full ECDHE/RSA exchange. The whole cache can be saved to a buffer
+// (e.g. RTC memory) or a file and restored after deep sleep.
+
+#define SL_TLS_CACHE_HOSTS 8
+#define SL_TLS_MASTER_LEN 48
+
+class TlsSessionCache {
+public:
+    struct Stats {
+        unsigned long full_count;
+        unsigned long full_ms;
+        unsigned long resumed_count;
+        unsigned long resumed_ms;
+    };
+
+    TlsSessionCache();
+    ~TlsSessionCache();
+
+    static TlsSessionCache& shared();
+
+    // Offer the cached session for host on a context that is set up but has
+    // not started its handshake. Copies the session's master secret (zeros if
+    // unknown) to master, so the caller can tell whether the server resumed.
+    bool apply(const char* host, mbedtls_ssl_context* ssl, unsigned char* master);
+    // Save the session of a completed handshake with its master secret
+    // (SL_TLS_MASTER_LEN bytes, or null if unknown)
+    void store(const char* host, const mbedtls_ssl_context* ssl, const unsigned char* master);
+    void remove(const char* host);
+    void clear();
+
+    void recordHandshake(unsigned long ms, bool resumed);
+    Stats stats() const;
+    void resetStats();
+    void printStats(Print& out) const;
+
+    // Persistence. Format: [u8 host_len][host][u16 len][session bytes][master]...
+    size_t save(uint8_t* buf, size_t capacity) const;
+    // Restores nothing from a malformed buffer
+    bool restore(const uint8_t* buf, size_t length);
+    bool saveToFile(const char* path) const;
+    bool loadFromFile(const char* path);
+
+private:
+    struct Entry {
+        char host[48];
+        uint8_t* data;
+        size_t length;
+        uint8_t master[SL_TLS_MASTER_LEN];
+    };
+
+    Entry* _find(const char* host);
+    void _put(const char* host, const uint8_t* data, size_t length, const uint8_t* master);
+
+    mutable std::mutex _mutex;
+    Entry _entries[SL_TLS_CACHE_HOSTS];
+    int _next_slot;
+    Stats _stats;
+};
+
+#endif
@@ -0,0 +1,134 @@
+#include "TraceBuffer.h"
+#include <functional>
+#include <new>
+#include <stdio.h>
+
+#if defined(ESP32)
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <thread>
+#endif
+
+TraceBuffer::TraceBuffer()
+    : _next(0), _count(0), _enabled(false)
+{
+}
+
+TraceBuffer& TraceBuffer::shared()
+{
+    static TraceBuffer instance;
+    return instance;
+}
+
+bool TraceBuffer::setEnabled(bool enabled)
+{
+    if (enabled)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_spans)
+        {
+            _spans.reset(new (std::nothrow) SL_TraceSpan[SL_TRACE_CAPACITY]);
+            if (!_spans) return false;
+        }
+    }
+    _enabled = enabled;
+    return true;
+}
+
+void TraceBuffer::record(const char* name, const char* category, uint32_t start_us, uint32_t duration_us,
+                         const char* detail, uint32_t thread)
+{
+    if (thread == 0) thread = currentThread();
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_spans) return;
+    SL_TraceSpan& s = _spans[_next];
+    s.name = name;
+    s.category = category;
+    s.start_us = start_us;
+    s.duration_us = duration_us;
+    s.thread = thread;
+    if (detail)
+    {
+        // Keep the end of long details: for URLs that is the informative part
+        size_t len = strlen(detail);
+        if (len >= sizeof(s.detail)) detail += len - (sizeof(s.detail) - 1);
+        memcpy(s.detail, detail, strlen(detail) + 1);
+    }
+    else s.detail[0] = 0;
+
+    _next = (_next + 1) % SL_TRACE_CAPACITY;
+    if (_count < SL_TRACE_CAPACITY) _count++;
+}
+
+void TraceBuffer::clear()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _next = 0;
+    _count = 0;
+    if (!_enabled) _spans.reset();
+}
+
+size_t TraceBuffer::size()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _count;
+}
+
+void TraceBuffer::exportChrome(Print& out)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    size_t first = (_next + SL_TRACE_CAPACITY - _count) % SL_TRACE_CAPACITY;
+
+    out.print("{\"traceEvents\":[");
+    for (size_t i = 0; i < _count; i++)
+    {
+        const SL_TraceSpan& s = _spans[(first + i) % SL_TRACE_CAPACITY];
+        char line[160];
+        snprintf(line, sizeof(line), "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%lu,\"dur\":%lu,\"pid\":1,\"tid\":%lu",
+                 i ? ",\n" : "\n", s.name, s.category, (unsigned long)s.start_us,
+                 (unsigned long)s.duration_us, (unsigned long)s.thread);
+        out.print(line);
+        if (s.detail[0])
+        {
+            // Details are URLs / paths / dates; drop anything that would need escaping
+            out.print(",\"args\":{\"detail\":\"");
+            for (const char* c = s.detail; *c; c++)
+            {
+                if (*c != '"' && *c != '\\' && (uint8_t)*c >= 0x20) out.write((uint8_t)*c);
+            }
+            out.print("\"}");
+        }
+        out.print("}");
+    }
+    out.println("\n],\"displayTimeUnit\":\"ms\"}");
+}
+
+bool TraceBuffer::exportChrome(const char* path)
+{
+    // stdio works on hosts and on ESP32 VFS paths such as /spiffs or /sd
+    class FilePrint : public Print {
+    public:
+        explicit FilePrint(FILE* f) : _f(f) {}
+        size_t write(uint8_t c) override { return fputc(c, _f) == EOF ? 0 : 1; }
+        size_t write(const uint8_t* buffer, size_t size) override { return fwrite(buffer, 1, size, _f); }
+
+    private:
+        FILE* _f;
+    };
+
+    FILE* f = fopen(path, "w");
+    if (!f) return false;
+    FilePrint out(f);
+    exportChrome(out);
+    return fclose(f) == 0;
+}
+
+uint32_t TraceBuffer::currentThread()
+{
+#if defined(ESP32)
+    return (uint32_t)(uintptr_t)xTaskGetCurrentTaskHandle();
+#else
+    return (uint32_t)std::hash<std::thread::id>()(std::this_thread::get_id());
+#endif
+}
@@ -0,0 +1,107 @@
+#ifndef TraceBuffer_h
+#define TraceBuffer_h
+
+#include <Arduino.h>
+#include <memory>
+#include <mutex>
+
+// Scoped trace spans for finding where a sync spends its time (login, each
+// request, TLS handshakes, parsing, sorting, yields). Finished spans go into a
+// fixed ring buffer, so recording never allocates and the newest spans win.
+// The ring (~15 KB at the default capacity) is allocated when tracing is first
+// enabled, so builds that never trace do not pay for it in RAM.
+// exportChrome() writes Chrome trace-event JSON that opens in Perfetto or
+// chrome://tracing, one track per thread / task.
+//
+// Off until TraceBuffer::shared().setEnabled(true); a disabled scope costs one
+// flag check. SL_TRACE_ENABLED=0 in build flags compiles the macros out.
+// Timestamps are micros(), which wraps after ~71 minutes on 32-bit targets:
+// export soon after the syncs of interest.
+
+#ifndef SL_TRACE_ENABLED
+#define SL_TRACE_ENABLED 1
+#endif
+
+#ifndef SL_TRACE_CAPACITY
+#define SL_TRACE_CAPACITY 256
+#endif
+
+#define SL_TRACE_DETAIL_LEN 40
+
+struct SL_TraceSpan {
+    const char* name;       // String literal; not copied
+    const char* category;
+    uint32_t start_us;
+    uint32_t duration_us;
+    uint32_t thread;
+    char detail[SL_TRACE_DETAIL_LEN];
+};
+
+class TraceBuffer {
+public:
+    TraceBuffer();
+
+    static TraceBuffer& shared();
+
+    // Enabling allocates the ring if needed; false if that fails. Disabling
+    // keeps the recorded spans for export.
+    bool setEnabled(bool enabled);
+    bool enabled() const { return _enabled; }
+
+    // Add a finished span; a long detail keeps its tail. thread 0 is
+    // the caller's; spans that overlap others on that thread (requests in
+    // flight together) pass their own track id so each gets a lane.
+    void record(const char* name, const char* category, uint32_t start_us, uint32_t duration_us,
+                const char* detail = nullptr, uint32_t thread = 0);
+    // Drops the spans, and the ring too while tracing is off
+    void clear();
+    size_t size();
+
+    // {"traceEvents":[...]} with complete ("X") events, oldest first
+    void exportChrome(Print& out);
+    bool exportChrome(const char* path);
+
+    static uint32_t currentThread();
+
+private:
+    std::mutex _mutex;
+    std::unique_ptr<SL_TraceSpan[]> _spans;   // SL_TRACE_CAPACITY spans once enabled
+    size_t _next;
+    size_t _count;
+    volatile bool _enabled;
+};
+
+// Records a span from construction to destruction
+class SL_TraceScope {
+public:
+    SL_TraceScope(const char* name, const char* category, const char* detail = nullptr)
+        : _name(name), _category(category), _detail(detail), _active(TraceBuffer::shared().enabled()) {
+        if (_active) _start = micros();
+    }
+    ~SL_TraceScope() {
+        if (_active) TraceBuffer::shared().record(_name, _category, _start, micros() - _start, _detail);
+    }
+
+private:
+    const char* _name;
+    const char* _category;
+    const char* _detail;  // Must outlive the scope
+    bool _active;
+    uint32_t _start = 0;
+};
+
+#define SL_TRACE_CONCAT2(a, b) a##b
+#define SL_TRACE_CONCAT(a, b) SL_TRACE_CONCAT2(a, b)
+
+#if SL_TRACE_ENABLED
+#define SL_TRACE_SCOPE(name, category) SL_TraceScope SL_TRACE_CONCAT(_sl_trace_, __LINE__)(name, category)
+#define SL_TRACE_SCOPE_D(name, category, detail) SL_TraceScope SL_TRACE_CONCAT(_sl_trace_, __LINE__)(name, category, detail)
+#define SL_TRACE_RECORD(name, category, start_us, duration_us, detail, thread) \
+    do { if (TraceBuffer::shared().enabled()) TraceBuffer::shared().record(name, category, start_us, duration_us, detail, thread); } while (0)
+#else
+#define SL_TRACE_SCOPE(name, category) do {} while (0)
+#define SL_TRACE_SCOPE_D(name, category, detail) do {} while (0)
+#define SL_TRACE_RECORD(name, category, start_us, duration_us, detail, thread) do {} while (0)
+#endif
+
+#endif
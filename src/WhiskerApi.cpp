@@ -1,5 +1,8 @@
 #include "WhiskerApi.h"
+#include "TraceBuffer.h"
+#include "JsonSchema.h"
 #include "mbedtls/base64.h"
+#include <algorithm>
 
 // Whisker / AWS Constants
 const char* COGNITO_ENDPOINT = "https://cognito-idp.us-east-1.amazonaws.com/";
@@ -8,29 +11,50 @@ const char* API_LR4_GRAPHQL = "https://lr4.iothings.site/graphql";
 const char* API_PET_GRAPHQL = "https://pet-profile.iothings.site/graphql";
 
 WhiskerApi::WhiskerApi(const char* email, const char* password, const char* timezone) 
-    : _email(email), _password(password), _timezone(timezone), _debug(false) {}
+    : _email(email), _password(password), _timezone(timezone), _log_level(SL_LOG_LEVEL_NONE),
+      _scheduler(&RequestScheduler::shared()), _transport(&defaultHttpTransport()),
+      _max_in_flight(SL_MAX_IN_FLIGHT), _have_pets(false), _have_robots(false), _full_refresh(true), _max_sync_limit(SL_WHISKER_MAX_SYNC_LIMIT), _max_records(SL_WHISKER_MAX_RECORDS) {
+    _retries_left = _scheduler->retryBudget();
+    _publish(true, true, true); // Empty, so readers never see a null part
+}
 
 WhiskerApi::~WhiskerApi()
 {
 
 }
 void WhiskerApi::setDebug(bool enabled) {
-    _debug = enabled;
+    _log_level = enabled ? SL_LOG_LEVEL_DEBUG : SL_LOG_LEVEL_NONE;
+}
+
+void WhiskerApi::setLogLevel(uint8_t level) {
+    _log_level = level;
+}
+
+void WhiskerApi::setScheduler(RequestScheduler& scheduler) {
+    _scheduler = &scheduler;
+}
+
+void WhiskerApi::setTransport(HttpTransport& transport) {
+    _transport = &transport;
 }
 
-void WhiskerApi::_log(const String& msg) {
-    if (_debug && Serial) Serial.println("[WhiskerApi] " + msg);
+void WhiskerApi::_logf(uint8_t level, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    sl_vlog(level, "[WhiskerApi] ", fmt, args);
+    va_end(args);
 }
 
 
 // --- Authentication ---
 bool WhiskerApi::login() {
-    if (WiFi.status() != WL_CONNECTED) {
-        _log("WiFi not connected.");
+    SL_TRACE_SCOPE("Whisker login", "auth");
+    if (!_transport->isConnected()) {
+        SL_LOGE("WiFi not connected.");
         return false;
     }
 
-    _log("Authenticating with AWS Cognito...");
+    SL_LOGI("Authenticating with AWS Cognito...");
 
     // Basic USER_PASSWORD_AUTH flow
     JsonDocument doc;
@@ -43,26 +67,42 @@ bool WhiskerApi::login() {
     String payload;
     serializeJson(doc, payload);
 
-    HTTPClient http;
-    http.begin(COGNITO_ENDPOINT);
-    http.addHeader("Content-Type", "application/x-amz-json-1.1");
-    http.addHeader("X-Amz-Target", "AWSCognitoIdentityProviderService.InitiateAuth");
-    http.setTimeout(10000); // 10s timeout
+    HttpRequest req;
+    req.method = "POST";
+    req.url = COGNITO_ENDPOINT;
+    req.body = (const uint8_t*)payload.c_str();
+    req.body_length = payload.length();
+    req.timeout_ms = _scheduler->timeoutFor(req, 10000);
+    req.connect_timeout_ms = _scheduler->connectTimeoutFor(req, 10000);
+    req.addHeader("Content-Type", "application/x-amz-json-1.1");
+    req.addHeader("X-Amz-Target", "AWSCognitoIdentityProviderService.InitiateAuth");
+
+    // Own budget: login also runs before a sync has set _retries_left
+    HttpResponse resp;
+    int httpCode;
+    int retries_left = _scheduler->retryBudget();
+    for (int attempt = 0;; attempt++) {
+        _scheduler->acquire(COGNITO_ENDPOINT);
+        unsigned long sent = millis();
+        httpCode = _transport->send(req, resp);
+        _scheduler->recordLatency(req, resp, millis() - sent);
+
+        long wait_ms = _scheduler->complete(COGNITO_ENDPOINT, httpCode,
+                                            RequestScheduler::parseRetryAfter(resp.retry_after),
+                                            attempt, retries_left);
+        if (wait_ms < 0) break;
+
+        SL_LOGW("Login HTTP %d, retrying in %ld ms", httpCode, wait_ms);
+    }
 
-    int httpCode = http.POST(payload);
-    
     if (httpCode != 200) {
-        _log("Login Failed: " + String(httpCode));
-        if (httpCode > 0) _log("Response: " + http.getString());
-        http.end();
+        SL_LOGE("Login Failed: %d", httpCode);
+        if (httpCode > 0) SL_LOGD("Response: %s", resp.body.c_str());
         return false;
     }
 
-    String response = http.getString();
-    http.end();
-
     JsonDocument respDoc;
-    deserializeJson(respDoc, response);
+    deserializeJson(respDoc, resp.body);
 
     if (respDoc["AuthenticationResult"]) {
         _id_token = respDoc["AuthenticationResult"]["IdToken"].as<String>();
@@ -70,12 +110,12 @@ bool WhiskerApi::login() {
         
         // Extract User ID (mid) from JWT
         if (_parseJwtForUserId(_id_token)) {
-            _log("Login Successful. User ID: " + _user_id);
+            SL_LOGI("Login Successful. User ID: %s", _user_id.c_str());
             return true;
         }
     }
     
-    _log("Failed to parse tokens.");
+    SL_LOGE("Failed to parse tokens.");
     return false;
 }
 
@@ -92,7 +132,7 @@ bool WhiskerApi::_parseJwtForUserId(const String& token) {
     
     unsigned char* decoded = (unsigned char*)malloc(len + 1);
     if (!decoded) {
-        _log("Memory allocation failed for JWT decode");
+        SL_LOGE("Memory allocation failed for JWT decode");
         return false;
     }
 
@@ -118,44 +158,118 @@ bool WhiskerApi::_parseJwtForUserId(const String& token) {
 
 // --- Main Data Fetch ---
 bool WhiskerApi::fetchAllData(int limit) {
+    SL_TRACE_SCOPE("Whisker sync", "sync");
     if (_id_token == "") {
         if (!login()) return false;
     }
     
-    _pets.clear();
-    _records.clear();
-    _status_records.clear(); // Clear old status info
+    _retries_left = _scheduler->retryBudget();
+
+    time_t now = time(nullptr);
+    bool full_refresh = _full_refresh;
+
+    if (_full_refresh) {
+        SL_LOGI("Full history refresh");
+        _full_refresh = false;
+        _cadence.invalidate(SL_DataClass::RECORDS);
+    }
 
     //Fetch Pets
-    _fetchPets();
+    bool pets_fetched = false;
+    if (_cadence.due(SL_DataClass::PETS, now)) {
+        pets_fetched = _fetchPets();
+        if (pets_fetched) {
+            _have_pets = true;
+            _cadence.markDone(SL_DataClass::PETS, now);
+        }
+    }
 
-    //For each Pet, fetch their specific weight history
-    for (const auto& pet : _pets) {
-        _fetchPetWeightHistory(pet, limit);
+    //Fetch Robot Status (also the list of robots the history pass walks)
+    bool robots_listed = false;
+    if (_cadence.due(SL_DataClass::STATUS, now)) {
+        robots_listed = _fetchRobots();
+        if (robots_listed) {
+            _have_robots = true;
+            _cadence.markDone(SL_DataClass::STATUS, now);
+        }
     }
 
-    //Fetch Robot Cycles and Status
-    _fetchRobotsAndCycles(limit);
+    bool synced = false;
+    if (_cadence.due(SL_DataClass::RECORDS, now)) {
+        // Restored if the pass fails, so its sources are fetched again
+        std::unordered_map<String, time_t, SL_StringHash> newest_seen = _newest_seen;
+        // Merge into a private version; readers keep the published records
+        // meanwhile, and chunks the merge does not touch stay shared
+        if (full_refresh) _newest_seen.clear();
+        else _records = _published.load()->records;
+        std::vector<WhiskerRecord> fresh;
+        // Complete only if every source was listed and synced
+        synced = _have_pets && _have_robots;
+
+        // First pages of every pet and robot go out together; a source only
+        // needs further (blocking) requests if its gap is not closed yet
+        std::vector<FirstPage> first;
+        _prefetchFirstPages(limit, first);
+        size_t source = 0;
+
+        //For each Pet, fetch weight history newer than what we hold
+        for (const auto& pet : _pets) {
+            FirstPage* pre = &first[source++];
+            synced &= _syncSource(pet.uuid, limit, fresh, [&, pre](int n, std::vector<WhiskerRecord>& page) {
+                if (pre->done && n == limit) {
+                    pre->done = false;
+                    page.swap(pre->page);
+                    return pre->returned;
+                }
+                return _fetchPetWeightHistory(pet, n, page);
+            });
+        }
 
-    //Sort all records by timestamp (descending)
-    std::sort(_records.begin(), _records.end(), [](const WhiskerRecord &a, const WhiskerRecord &b) {
-        return a.timestamp > b.timestamp;
-    });
+        //For each Robot, fetch cycles newer than what we hold
+        for (const auto& robot : _status_table.entries()) {
+            const String& serial = robot.device_serial;
+            FirstPage* pre = &first[source++];
+            synced &= _syncSource(serial, limit, fresh, [&, pre](int n, std::vector<WhiskerRecord>& page) {
+                if (pre->done && n == limit) {
+                    pre->done = false;
+                    page.swap(pre->page);
+                    return pre->returned;
+                }
+                return _fetchRobotActivity(serial, n, page);
+            });
+        }
 
+        _mergeRecords(fresh);
+        if (synced) {
+            // Only complete data is folded: compaction never revisits a day
+            _compactRecords();
+            _trimRecords();
+            _cadence.markDone(SL_DataClass::RECORDS, now);
+        } else {
+            // Readers keep the published records; the next pass redoes this one
+            _records.clear();
+            _newest_seen.swap(newest_seen);
+            if (full_refresh) _full_refresh = true;
+        }
+    }
+
+    if (robots_listed) _detectChanges();
+
+    // Readers switch to this fetch's data in one step
+    _publish(pets_fetched, synced, robots_listed);
     return true;
 }
 
-void WhiskerApi::_fetchPets() {
-    String query = "query GetPetsByUser($userId: String!) { getPetsByUser(userId: $userId) { petId name weight } }";
-    String vars = "{\"userId\":\"" + _user_id + "\"}";
-    
-    String response = _sendGraphQL(API_PET_GRAPHQL, query, vars);
-    if (response == "{}") return;
+bool WhiskerApi::_fetchPets() {
+    SL_TRACE_SCOPE("fetchPets", "sync");
+    GraphQLRequest req("query GetPetsByUser($userId: String!) { getPetsByUser(userId: $userId) { petId name weight } }");
+    req.vars()["userId"] = _user_id;
 
     JsonDocument doc;
-    deserializeJson(doc, response);
+    if (!_sendGraphQL(API_PET_GRAPHQL, req, doc)) return false;
     JsonArray arr = doc["data"]["getPetsByUser"].as<JsonArray>();
 
+    _pets.clear();
     for (JsonObject obj : arr) {
         WhiskerPet p;
         p.uuid = obj["petId"].as<String>();
@@ -163,68 +277,109 @@ void WhiskerApi::_fetchPets() {
         p.weight_lbs = obj["weight"].as<float>();
         p.id = _simpleHash(p.uuid);
         _pets.push_back(p);
-        _log("Found Pet: " + p.name);
+        SL_LOGD("Found Pet: %s", p.name.c_str());
     }
+    return true;
 }
 
-void WhiskerApi::_fetchPetWeightHistory(const WhiskerPet& pet, int limit) {
-    String query = "query GetWeightHistory($petId: String!, $limit: Int) { getWeightHistoryByPetId(petId: $petId, limit: $limit) { weight timestamp } }";
-    String vars = "{\"petId\":\"" + pet.uuid + "\", \"limit\":" + String(limit) + "}";
+// Returns the number of entries the server sent, or -1 on failure
+int WhiskerApi::_fetchPetWeightHistory(const WhiskerPet& pet, int limit, std::vector<WhiskerRecord>& page) {
+    JsonDocument doc;
+    if (!_sendRequest(API_PET_GRAPHQL, "POST", _weightQuery(pet, limit), doc, RequestScheduler::sizeClass(limit))) return -1;
+    return _parseWeightHistory(pet, doc, page);
+}
 
-    String response = _sendGraphQL(API_PET_GRAPHQL, query, vars);
-    if (response == "{}") return;
+String WhiskerApi::_weightQuery(const WhiskerPet& pet, int limit) {
+    GraphQLRequest req("query GetWeightHistory($petId: String!, $limit: Int) { getWeightHistoryByPetId(petId: $petId, limit: $limit) { weight timestamp } }");
+    req.vars()["petId"] = pet.uuid;
+    req.vars()["limit"] = limit;
+    String payload;
+    req.serialize(payload);
+    return payload;
+}
 
-    JsonDocument doc;
-    deserializeJson(doc, response);
+// Keys read from weight history entries, robots and activity entries
+enum { WEIGHT_WEIGHT, WEIGHT_TIMESTAMP, WEIGHT_FIELDS };
+static constexpr SL_Key kWeightKeys[WEIGHT_FIELDS] = { SL_KEY("weight"), SL_KEY("timestamp") };
+
+enum { ROBOT_SERIAL, ROBOT_STATUS, ROBOT_DFI_LEVEL, ROBOT_DFI_FULL, ROBOT_LITTER_LEVEL, ROBOT_FIELDS };
+static constexpr SL_Key kRobotKeys[ROBOT_FIELDS] = {
+    SL_KEY("serial"), SL_KEY("robotStatus"), SL_KEY("DFILevelPercent"), SL_KEY("isDFIFull"), SL_KEY("litterLevel") };
+
+enum { ACT_TIMESTAMP, ACT_VALUE, ACT_FIELDS };
+static constexpr SL_Key kActivityKeys[ACT_FIELDS] = { SL_KEY("timestamp"), SL_KEY("value") };
+
+// Activity values with special handling
+enum { ACTIVITY_CAT_WEIGHT, ACTIVITY_CYCLE_IDLE, ACTIVITY_DFI_FULL };
+static constexpr SL_Key kActivityValues[] = {
+    SL_KEY("catWeight"), SL_KEY("robotCycleStatusIdle"), SL_KEY("DFIFullFlagOn") };
+
+// robotStatus codes, indexed by WhiskerRobotState
+static constexpr SL_Key kRobotStates[] = {
+    SL_KEY("ROBOT_IDLE"), SL_KEY("ROBOT_CLEAN"), SL_KEY("ROBOT_CAT_DETECT") };
+static_assert(sizeof(kRobotStates) / sizeof(kRobotStates[0]) == (size_t)WhiskerRobotState::FAULT, "one code per named state");
+
+static WhiskerRobotState robotState(JsonString code) {
+    int i = sl_findKey(kRobotStates, code);
+    if (i >= 0) return (WhiskerRobotState)i;
+    if (code.c_str() && strstr(code.c_str(), "FAULT")) return WhiskerRobotState::FAULT;
+    return WhiskerRobotState::OTHER;
+}
+
+int WhiskerApi::_parseWeightHistory(const WhiskerPet& pet, JsonDocument& doc, std::vector<WhiskerRecord>& page) {
     JsonArray history = doc["data"]["getWeightHistoryByPetId"].as<JsonArray>();
 
     for (JsonObject item : history) {
+        SL_Fields<WEIGHT_FIELDS> f(item, kWeightKeys);
         WhiskerRecord r;
         r.pet_uuid = pet.uuid;
         r.pet_id = pet.id;
         r.pet_name = pet.name;
         r.event_type = "Pet Weight Recorded"; 
         r.device_model = "Litter-Robot 4";    
-        r.weight_lbs = item["weight"].as<float>();
+        r.weight_lbs = f[WEIGHT_WEIGHT].as<float>();
         
-        const char* ts = item["timestamp"];
-        struct tm tm = {0};
+        const char* ts = f[WEIGHT_TIMESTAMP].as<const char*>();
+        struct tm tm = {};
         strptime(ts, "%Y-%m-%dT%H:%M:%S", &tm);
         r.timestamp = mktime(&tm);
 
-        _records.push_back(r);
+        page.push_back(r);
     }
+    return history.size();
 }
 
-void WhiskerApi::_fetchRobotsAndCycles(int limit) {
+// Returns false if the robot list could not be fetched
+bool WhiskerApi::_fetchRobots() {
+    SL_TRACE_SCOPE("fetchRobots", "sync");
     //Fetch status fields (litterLevel, DFI, etc)
-    String query = "query GetLR4($userId: String!) { getLitterRobot4ByUser(userId: $userId) { serial name litterLevel DFILevelPercent isDFIFull robotStatus } }";
-    String vars = "{\"userId\":\"" + _user_id + "\"}";
-    String response = _sendGraphQL(API_LR4_GRAPHQL, query, vars);
-    if (response == "{}") return;
-
+    GraphQLRequest req("query GetLR4($userId: String!) { getLitterRobot4ByUser(userId: $userId) { serial name litterLevel DFILevelPercent isDFIFull robotStatus } }");
+    req.vars()["userId"] = _user_id;
     JsonDocument doc;
-    deserializeJson(doc, response);
+    if (!_sendGraphQL(API_LR4_GRAPHQL, req, doc)) return false;
     JsonArray robots = doc["data"]["getLitterRobot4ByUser"].as<JsonArray>();
 
+    _status_table.clear(); // Clear old status info
     for (JsonObject robot : robots) {
-        String serial = robot["serial"].as<String>();
+        SL_Fields<ROBOT_FIELDS> f(robot, kRobotKeys);
+        String serial = f[ROBOT_SERIAL].as<String>();
         
         //CAPTURE CURRENT STATUS ---
         WhiskerStatus status;
         status.device_serial = serial;
         status.device_model = "Litter-Robot 4";
         status.timestamp = time(nullptr);
-        status.robot_status = robot["robotStatus"].as<String>();
+        status.robot_status = f[ROBOT_STATUS].as<String>();
+        status.robot_state = robotState(f[ROBOT_STATUS].as<JsonString>());
         
         // Waste Level (DFI)
-        status.waste_level_percent = robot["DFILevelPercent"].as<int>();
-        status.is_drawer_full = robot["isDFIFull"].as<bool>();
+        status.waste_level_percent = f[ROBOT_DFI_LEVEL].as<int>();
+        status.is_drawer_full = f[ROBOT_DFI_FULL].as<bool>();
 
         // Litter Level Calculation (Raw mm to %)
         // Based on logic: 100 - (raw_mm - 440) / 0.6
         // 440mm = Full, ~500mm = Empty
-        int rawLitter = robot["litterLevel"].as<int>();
+        int rawLitter = f[ROBOT_LITTER_LEVEL].as<int>();
         if (rawLitter > 0) {
             float calc = 100.0 - ((float)(rawLitter - 440) / 0.6);
             if (calc < 0) calc = 0;
@@ -234,102 +389,330 @@ void WhiskerApi::_fetchRobotsAndCycles(int limit) {
             status.litter_level_percent = 0; // Unknown/Error
         }
 
-        _status_records.push_back(status);
-        _log("Status fetched for " + status.device_serial + ": Litter " + String(status.litter_level_percent) + "%");
+        _status_table.update(serial, status);
+        _emitStatus(_toUnifiedStatus(status));
+        SL_LOGD("Status fetched for %s: Litter %d%%", status.device_serial.c_str(), status.litter_level_percent);
+    }
+    return true;
+}
+
+// Diff this fetch's robot statuses against the previous one and emit SL_Events
+void WhiskerApi::_detectChanges() {
+    _changes.beginRound();
+    for (const auto& r : _status_table.entries()) {
+        _changes.observe(_toUnifiedStatus(r), _on_event);
+    }
+    _changes.endRound(_on_event);
+}
+
+// Returns the number of entries the server sent, or -1 on failure
+int WhiskerApi::_fetchRobotActivity(const String& serial, int limit, std::vector<WhiskerRecord>& page) {
+    JsonDocument actDoc;
+    if (!_sendRequest(API_LR4_GRAPHQL, "POST", _activityQuery(serial, limit), actDoc, RequestScheduler::sizeClass(limit))) return -1;
+    return _parseRobotActivity(serial, actDoc, page);
+}
+
+String WhiskerApi::_activityQuery(const String& serial, int limit) {
+    GraphQLRequest actReq("query GetActivity($serial: String!, $limit: Int) { getLitterRobot4Activity(serial: $serial, limit: $limit) { timestamp value actionValue } }");
+    actReq.vars()["serial"] = serial;
+    actReq.vars()["limit"] = limit;
+    String payload;
+    actReq.serialize(payload);
+    return payload;
+}
+
+int WhiskerApi::_parseRobotActivity(const String& serial, JsonDocument& actDoc, std::vector<WhiskerRecord>& page) {
+    JsonArray activities = actDoc["data"]["getLitterRobot4Activity"].as<JsonArray>();
+
+    for (JsonObject act : activities) {
+        SL_Fields<ACT_FIELDS> f(act, kActivityKeys);
+        JsonString val = f[ACT_VALUE].as<JsonString>();
+        int known = sl_findKey(kActivityValues, val);
+        if (known == ACTIVITY_CAT_WEIGHT) continue;
 
-        // --- FETCH HISTORY ---
-        String actQuery = "query GetActivity($serial: String!, $limit: Int) { getLitterRobot4Activity(serial: $serial, limit: $limit) { timestamp value actionValue } }";
-        String actVars = "{\"serial\":\"" + serial + "\", \"limit\":" + String(limit) + "}";
+        WhiskerRecord r;
+        r.device_serial = serial;
+        r.device_model = "Litter-Robot 4";
         
-        String actResp = _sendGraphQL(API_LR4_GRAPHQL, actQuery, actVars);
-        if (actResp == "{}") continue;
-
-        JsonDocument actDoc;
-        deserializeJson(actDoc, actResp);
-        JsonArray activities = actDoc["data"]["getLitterRobot4Activity"].as<JsonArray>();
-
-        for (JsonObject act : activities) {
-            String val = act["value"].as<String>();
-            if (val == "catWeight") continue;
-
-            WhiskerRecord r;
-            r.device_serial = serial;
-            r.device_model = "Litter-Robot 4";
-            r.pet_uuid = ""; 
-            r.pet_name = "";
-            
-            if (val == "robotCycleStatusIdle") r.event_type = "Clean Cycle Complete";
-            else if (val == "DFIFullFlagOn") r.event_type = "Drawer Full";
-            else r.event_type = val;
-
-            const char* ts = act["timestamp"];
-            struct tm tm = {0};
-            strptime(ts, "%Y-%m-%d %H:%M:%S", &tm);
-            r.timestamp = mktime(&tm);
-
-            _records.push_back(r);
-        }
+        if (known == ACTIVITY_CYCLE_IDLE) r.event_type = "Clean Cycle Complete";
+        else if (known == ACTIVITY_DFI_FULL) r.event_type = "Drawer Full";
+        else if (!val.isNull()) r.event_type = val.c_str();
+        else r.event_type = f[ACT_VALUE].as<String>(); // Missing or not a string: "null" or its JSON, as before
+
+        const char* ts = f[ACT_TIMESTAMP].as<const char*>();
+        struct tm tm = {};
+        strptime(ts, "%Y-%m-%d %H:%M:%S", &tm);
+        r.timestamp = mktime(&tm);
+
+        page.push_back(r);
     }
+    return activities.size();
 }
 
-// Auto-retry on 401 Unauthorized
-String WhiskerApi::_sendRequest(const char* url, const char* method, const String& payload, const char* contentType) {
-    if (WiFi.status() != WL_CONNECTED) return "{}";
+// --- Incremental Sync ---
+
+// Pets first, then robots, in the order fetchAllData() walks them. Any page
+// that needs a re-login or a retry is left !done for the blocking path.
+void WhiskerApi::_prefetchFirstPages(int limit, std::vector<FirstPage>& pages) {
+    SL_TRACE_SCOPE("first pages", "sync");
+    const std::vector<WhiskerStatus>& robots = _status_table.entries();
+    pages.clear();
+    pages.resize(_pets.size() + robots.size());
+
+    RequestBatch batch(*_transport, *_scheduler, _retries_left, _max_in_flight);
+    std::vector<JsonDocument> docs(batch.window());
+    std::vector<DeserializationError> errors(batch.window());
+    std::vector<String> payloads(batch.window());
+
+    auto urlOf = [&](size_t index) {
+        return index < _pets.size() ? API_PET_GRAPHQL : API_LR4_GRAPHQL;
+    };
+
+    auto prepare = [&](size_t index, size_t slot, HttpRequest& req) {
+        payloads[slot] = index < _pets.size() ? _weightQuery(_pets[index], limit)
+                                              : _activityQuery(robots[index - _pets.size()].device_serial, limit);
+        _buildRequest(req, urlOf(index), "POST", payloads[slot], "application/json", RequestScheduler::sizeClass(limit));
+        req.idempotent = true;  // GraphQL query; may be hedged
+        // Parsed as it arrives, on the transport's thread
+        docs[slot].clear();
+        errors[slot] = DeserializationError::EmptyInput;
+        JsonDocument* doc = &docs[slot];
+        DeserializationError* error = &errors[slot];
+        req.body_handler = [doc, error](Stream& body) {
+            SL_TRACE_SCOPE("read + parse body", "json");
+            *error = deserializeJson(*doc, body);
+        };
+        return true;
+    };
+
+    auto complete = [&](size_t index, size_t slot, HttpResponse& resp, bool settled) {
+        if (!settled) return;
+        FirstPage& first = pages[index];
+        first.done = true;
+        if (!_checkResponse(urlOf(index), resp, errors[slot])) return;
+        first.returned = index < _pets.size()
+            ? _parseWeightHistory(_pets[index], docs[slot], first.page)
+            : _parseRobotActivity(robots[index - _pets.size()].device_serial, docs[slot], first.page);
+    };
+
+    batch.run(pages.size(), prepare, complete, [&]() { return _transport->isConnected(); });
+}
 
-    HTTPClient http;
-    http.setTimeout(15000); 
-    http.setReuse(false); 
+// The API only takes a limit, so "paging" means asking for a longer tail until
+// the oldest entry returned is one we already hold (or the source runs out).
+// False if a request failed.
+bool WhiskerApi::_syncSource(const String& source, int limit, std::vector<WhiskerRecord>& fresh,
+                             const std::function<int(int, std::vector<WhiskerRecord>&)>& fetch) {
+    auto seen = _newest_seen.find(source);
+    time_t known = (seen == _newest_seen.end()) ? 0 : seen->second;
+    // Behind `known` only after a full refresh, which refetches history
+    // that onRecord() has already had
+    time_t& delivered = _delivered[source];
+    std::vector<WhiskerRecord> page;
+
+    for (;;) {
+        page.clear();
+        int returned = fetch(limit, page);
+        if (returned < 0) return false;
+
+        time_t oldest = 0;
+        for (const auto& r : page) {
+            if (oldest == 0 || r.timestamp < oldest) oldest = r.timestamp;
+        }
+        bool caught_up = known == 0 || returned < limit || (oldest != 0 && oldest <= known);
+        if (caught_up || limit >= _max_sync_limit) {
+            if (!caught_up) SL_LOGW("%s: gap not closed at limit %d", source.c_str(), limit);
+            break;
+        }
+        limit = std::min(limit * 2, _max_sync_limit);
+        SL_LOGD("%s: no overlap yet, growing limit to %d", source.c_str(), limit);
+    }
 
-    http.begin(url);
-    http.addHeader("Content-Type", contentType);
-    if (_id_token.length() > 0) {
-        http.addHeader("Authorization", "Bearer " + _id_token);
+    // Entries at the watermark may still be new (same second, other type)
+    time_t newest = known;
+    for (auto& r : page) {
+        if (r.timestamp < known) continue;
+        if (r.timestamp == known && _isHeld(r)) continue;
+        if (r.timestamp > newest) newest = r.timestamp;
+
+        // At the watermark only the held check above can tell new from old
+        SL_RecordView view;
+        bool undelivered = r.timestamp > delivered || (r.timestamp == delivered && known == delivered);
+        if (undelivered && _toView(r, view)) _emitRecord(view);
+        if (!_store_records) continue;
+        if (undelivered) {
+            // Its day is already rolled up; compaction drops it from the raw list
+            _toEntryView(r, view);
+            _rollups.foldLate(view);
+        }
+        fresh.push_back(std::move(r));
     }
+    if (newest > known) _newest_seen[source] = newest;
+    if (newest > delivered) delivered = newest;
+    return true;
+}
 
-    int httpCode = 0;
-    if (String(method) == "POST") httpCode = http.POST(payload);
-    else httpCode = http.GET();
+// Without storage there is nothing to compare against; the watermark decides
+bool WhiskerApi::_isHeld(const WhiskerRecord& r) const {
+    if (!_store_records) return true;
+    for (const auto& h : _records) { // Newest first
+        if (h.timestamp < r.timestamp) break;
+        if (h.timestamp == r.timestamp && h.event_type == r.event_type && _sourceOf(h) == _sourceOf(r)) return true;
+    }
+    return false;
+}
 
-    // Check for Token Expiry (401)
-    if (httpCode == 401) {
-        _log("Token expired. Attempting re-login...");
-        http.end(); 
-        
-        if (login()) {
-            _log("Re-login successful. Retrying request...");
-            http.begin(url);
-            http.addHeader("Content-Type", contentType);
-            http.addHeader("Authorization", "Bearer " + _id_token);
-            
-            if (String(method) == "POST") httpCode = http.POST(payload);
-            else httpCode = http.GET();
-        } else {
-            _log("Re-login failed.");
-            return "{}";
+// Newest first; ties ordered by source then type so duplicates end up adjacent
+bool WhiskerApi::_newerFirst(const WhiskerRecord& a, const WhiskerRecord& b) {
+    if (a.timestamp != b.timestamp) return a.timestamp > b.timestamp;
+    int c = strcmp(_sourceOf(a).c_str(), _sourceOf(b).c_str());
+    if (c != 0) return c < 0;
+    return strcmp(a.event_type.c_str(), b.event_type.c_str()) < 0;
+}
+
+void WhiskerApi::_mergeRecords(std::vector<WhiskerRecord>& fresh) {
+    SL_TRACE_SCOPE("sort + merge records", "sync");
+    std::sort(fresh.begin(), fresh.end(), _newerFirst);
+    // Dedupes on (source, timestamp, type), which is what _newerFirst orders by
+    size_t added = _records.merge(fresh, _newerFirst);
+    SL_LOGD("Merged %u new records (%u held)", (unsigned)added, (unsigned)_records.size());
+}
+
+// Fold records older than the raw retention window into daily rollups.
+// _records is newest first, so everything past the cutoff is one tail. Late
+// records from before an earlier cutoff were counted by _syncSource.
+void WhiskerApi::_compactRecords() {
+    SL_TRACE_SCOPE("compact records", "sync");
+    // The merged records are not published yet; the view shares their chunks
+    Snapshot pending;
+    pending.records = _records;
+    time_t cutoff = _rollups.compact(pending, time(nullptr));
+    if (cutoff == 0) return;
+
+    size_t keep = _records.prefixLength([cutoff](const WhiskerRecord& r) { return r.timestamp >= cutoff; });
+    SL_LOGD("Compacted %u raw records", (unsigned)(_records.size() - keep));
+    _records.truncate(keep);
+}
+
+// Drop the oldest records beyond _max_records. With rollups on, a record
+// newer than compactedThrough() is not counted anywhere else, so it stays.
+void WhiskerApi::_trimRecords() {
+    if (_records.size() <= _max_records) return;
+    size_t keep = _max_records;
+    if (_rollups.rawRetentionDays() > 0) {
+        time_t counted = _rollups.compactedThrough();
+        keep = std::max(keep, _records.prefixLength([counted](const WhiskerRecord& r) { return r.timestamp >= counted; }));
+    }
+    _records.truncate(keep);
+}
+
+// Swap in a snapshot with the parts this fetch rebuilt; the others are shared
+// with the current one. Records move out of the working state.
+void WhiskerApi::_publish(bool pets, bool records, bool statuses) {
+    std::shared_ptr<const Snapshot> current = _published.load();
+    std::shared_ptr<Snapshot> next = current ? std::make_shared<Snapshot>(*current) : std::make_shared<Snapshot>();
+    if (pets) next->pets = std::make_shared<const std::vector<WhiskerPet>>(_pets);
+    if (records) {
+        next->records = std::move(_records);
+        _records.clear();
+    }
+    if (statuses) next->statuses = std::make_shared<const DeviceStatusTable<WhiskerStatus>>(_status_table);
+    if (records) {
+        // Copied only when compaction or new names changed it
+        _rollups.addNames(*next);
+        if (!next->rollups || next->rollups->revision() != _rollups.revision()) {
+            next->rollups = std::make_shared<const DailyRollupStore>(_rollups);
         }
     }
+    _published.publish(next);
+}
 
-    if (httpCode > 0) {
-        String res = http.getString();
-        http.end();
-        return res;
-    } else {
-        _log("Request failed: " + http.errorToString(httpCode));
+void WhiskerApi::_buildRequest(HttpRequest& req, const char* url, const char* method, const String& payload, const char* contentType, uint8_t size_class) {
+    req.method = method;
+    req.url = url;
+    req.body = (const uint8_t*)payload.c_str();
+    req.body_length = payload.length();
+    req.size_class = size_class;
+    // Derived from this endpoint's measured latency; 15 s until there are samples
+    req.timeout_ms = _scheduler->timeoutFor(req, 15000);
+    req.connect_timeout_ms = _scheduler->connectTimeoutFor(req, 15000);
+
+    req.header_count = 0;
+    req.addHeader("Content-Type", contentType);
+    if (_id_token.length() > 0) {
+        req.addHeader("Authorization", "Bearer " + _id_token);
     }
-    
-    http.end();
-    return "{}";
 }
 
-String WhiskerApi::_sendGraphQL(const char* url, const String& query, const String& variables) {
-    JsonDocument doc;
-    doc["query"] = query;
-    if (variables != "") {
-        JsonDocument varDoc;
-        deserializeJson(varDoc, variables);
-        doc["variables"] = varDoc;
+// Auto-retry on 401 Unauthorized, backoff on 429/5xx.
+// The 2xx body is parsed straight into out as it arrives (gzip if offered).
+bool WhiskerApi::_sendRequest(const char* url, const char* method, const String& payload, JsonDocument& out,
+                              uint8_t size_class, const char* contentType) {
+    SL_TRACE_SCOPE_D("request", "http", url);
+    if (!_transport->isConnected()) return false;
+
+    HttpRequest req;
+    HttpResponse resp;
+    _buildRequest(req, url, method, payload, contentType, size_class);
+    DeserializationError error = DeserializationError::EmptyInput;
+    req.body_handler = [&](Stream& body) {
+        SL_TRACE_SCOPE("read + parse body", "json");
+        error = deserializeJson(out, body);
+    };
+    bool relogged = false;
+
+    for (int attempt = 0;; attempt++) {
+        _scheduler->acquire(url);
+        unsigned long sent = millis();
+        _transport->send(req, resp);
+        _scheduler->recordLatency(req, resp, millis() - sent);
+
+        // Check for Token Expiry (401)
+        if (resp.status == 401 && !relogged) {
+            SL_LOGI("Token expired. Attempting re-login...");
+            relogged = true;
+
+            if (!login()) {
+                SL_LOGE("Re-login failed.");
+                return false;
+            }
+            SL_LOGI("Re-login successful. Retrying request...");
+            _buildRequest(req, url, method, payload, contentType, size_class);
+            attempt--; // Re-login is not a backoff retry
+            continue;
+        }
+
+        long wait_ms = _scheduler->complete(url, resp.status,
+                                            RequestScheduler::parseRetryAfter(resp.retry_after),
+                                            attempt, _retries_left);
+        if (wait_ms < 0) break;
+
+        SL_LOGW("HTTP %d, retrying in %ld ms", resp.status, wait_ms);
     }
+
+    return _checkResponse(url, resp, error);
+}
+
+// Shared by the blocking path and batched (submitted) requests
+bool WhiskerApi::_checkResponse(const char* url, const HttpResponse& resp, DeserializationError error) {
+    if (resp.status <= 0) {
+        SL_LOGE("Request failed: %s", resp.error.c_str());
+        return false;
+    }
+    if (resp.status < 200 || resp.status > 299) {
+        SL_LOGW("HTTP %d from %s", resp.status, url);
+        return false;
+    }
+    if (error) {
+        SL_LOGW("JSON parse failed: %s", error.c_str());
+        return false;
+    }
+    SL_LOGD("%u bytes on the wire, %u decoded", (unsigned)resp.wire_bytes, (unsigned)resp.body_bytes);
+    return true;
+}
+
+bool WhiskerApi::_sendGraphQL(const char* url, const GraphQLRequest& request, JsonDocument& out) {
     String payload;
-    serializeJson(doc, payload);
-    return _sendRequest(url, "POST", payload);
-}
\ No newline at end of file
+    request.serialize(payload);
+    return _sendRequest(url, "POST", payload, out);
+}
@@ -3,10 +3,23 @@
 
 #include <Arduino.h>
 #include "SmartLitterbox.h"
-#include <HTTPClient.h>
-#include <WiFiClientSecure.h>
+#include "RequestScheduler.h"
+#include "RequestBuilder.h"
+#include "HttpTransport.h"
+#include "RequestBatch.h"
+#include "DeviceStatusTable.h"
+#include "DailyRollupStore.h"
+#include "ChangeDetector.h"
+#include "SnapshotCell.h"
+#include "RecordChunks.h"
+#include "SL_Log.h"
 #include <ArduinoJson.h>
 #include <vector>
+#include <unordered_map>
+#include <functional>
+
+#define SL_WHISKER_MAX_SYNC_LIMIT 200
+#define SL_WHISKER_MAX_RECORDS 1000
 
 struct WhiskerPet {
     String uuid;
@@ -27,6 +40,15 @@ struct WhiskerRecord {
 };
 
 // New Status Structure
+// robotStatus codes the library tells apart; parsed once per fetch
+enum class WhiskerRobotState : uint8_t {
+    IDLE,
+    CLEANING,
+    CAT_DETECTED,
+    FAULT,                      // Any *FAULT* code
+    OTHER
+};
+
 struct WhiskerStatus {
     String device_serial;
     String device_model;
@@ -35,22 +57,70 @@ struct WhiskerStatus {
     int waste_level_percent;    // DFI Level
     bool is_drawer_full;
     String robot_status;        // e.g., ROBOT_IDLE, ROBOT_CLEAN
+    WhiskerRobotState robot_state = WhiskerRobotState::OTHER;
 };
 
 class WhiskerApi : public SmartLitterbox {
 public:
+    // What readers see, swapped in whole at the end of each fetch. Parts the
+    // fetch did not touch are shared with the previous snapshot.
+    struct Snapshot : SL_RecordSource {
+        std::shared_ptr<const std::vector<WhiskerPet>> pets;
+        RecordChunks<WhiskerRecord> records;                               // Newest first
+        std::shared_ptr<const DeviceStatusTable<WhiskerStatus>> statuses;  // One per robot
+        std::shared_ptr<const DailyRollupStore> rollups;
+
+        size_t recordCount() const override { return records.size(); }
+        bool recordAt(size_t index, SL_RecordView& out) const override {
+            return _toView(records[index], out);
+        }
+        bool entryAt(size_t index, SL_RecordView& out) const override {
+            _toEntryView(records[index], out);
+            return true;
+        }
+        const DailyRollupStore* dailyRollups() const override { return rollups.get(); }
+    };
+
     WhiskerApi(const char* email, const char* password, const char* timezone);
     ~WhiskerApi();
     // --- Interface Implementation ---
     bool login() override;
+    // Incremental: limit is the first page size per pet / robot, grown until
+    // the page reaches events already held. New events are merged in.
     bool fetchAllData(int limit = 10) override;
     void setDebug(bool enabled) override;
+    void setLogLevel(uint8_t level) override;
+
+    // Defaults to RequestScheduler::shared()
+    void setScheduler(RequestScheduler& scheduler);
+    // Defaults to defaultHttpTransport()
+    void setTransport(HttpTransport& transport);
+    // First-page queries kept in flight at once on an asynchronous transport
+    // (default SL_MAX_IN_FLIGHT)
+    void setMaxInFlight(size_t requests) { _max_in_flight = requests ? requests : 1; }
+
+    // Next fetchAllData() drops stored history and refetches `limit` per
+    // source; onRecord() only sees events it has not had before
+    void requestFullRefresh() { _full_refresh = true; }
+    // LITTER_LOW / LITTER_REFILLED events fire when crossing this (default 20%)
+    void setLitterLowThreshold(int percent) { _changes.setLitterLowThreshold(percent); }
+    // Largest page requested while catching up on missed events
+    void setMaxSyncLimit(int limit) { _max_sync_limit = limit; }
+    // Oldest raw history beyond this many records is dropped. With rollups on
+    // (setRawRetentionDays) only records already rolled up are, so raw history
+    // within the retention window is kept even past the cap.
+    void setMaxRecords(size_t count) { _max_records = count; }
+
+    // Current data without copying; never waits for a running fetch
+    std::shared_ptr<const Snapshot> snapshot() const { return _published.load(); }
+    std::shared_ptr<const SL_RecordSource> recordSource() const override { return snapshot(); }
 
     std::vector<SL_Pet> getUnifiedPets() const override {
+        std::shared_ptr<const Snapshot> snap = snapshot();
         std::vector<SL_Pet> unified;
-        for (const auto& p : _pets) {
+        for (const auto& p : *snap->pets) {
             SL_Pet slp;
-            slp.id = p.id;
+            slp.id = String(p.id);
             slp.name = p.name;
             slp.weight_lbs = p.weight_lbs;
             unified.push_back(slp);
@@ -59,8 +129,9 @@ public:
     }
 
     std::vector<SL_Record> getUnifiedRecords() const override {
+        std::shared_ptr<const Snapshot> snap = snapshot();
         std::vector<SL_Record> unified;
-        for (const auto& r : _records) {
+        for (const auto& r : snap->records) {
             if (r.pet_name.length() > 0 || r.event_type == "Pet Weight Recorded") {
                 SL_Record slr;
                 slr.pet_name = r.pet_name.length() > 0 ? r.pet_name : "Unknown Cat";
@@ -78,67 +149,173 @@ public:
 
     uint32_t _simpleHash(String str) {
     uint32_t hash = 5381;
-    for (int i = 0; i < str.length(); i++) {
+    for (unsigned int i = 0; i < str.length(); i++) {
         hash = ((hash << 5) + hash) + str.charAt(i); /* hash * 33 + c */
     }
     return hash;
 }
 
     // New Unified Status Implementation
+    // Newest status across all robots; see getUnifiedStatuses() for every device
     SL_Status getUnifiedStatus() const override {
-        if (_status_records.empty()) return SL_Status{ApiType::WHISKER,"", "", 0, 0, 0, false, false, "Unknown"};
-        
-        const auto& r = _status_records.front();
-        SL_Status s;
-        s.api_type = ApiType::WHISKER;
-        s.device_name = r.device_serial; // Whisker uses Serial as primary ID often
-        s.device_type = r.device_model;
-        s.timestamp = r.timestamp;
-        s.litter_level_percent = r.litter_level_percent;
-        s.waste_level_percent = r.waste_level_percent;
-        s.is_drawer_full = r.is_drawer_full;
-        
-        // Map common Whisker statuses to text
-        s.status_text = r.robot_status; 
-        if (r.robot_status == "ROBOT_IDLE") s.status_text = "Ready";
-        else if (r.robot_status == "ROBOT_CLEAN") s.status_text = "Cleaning";
-        else if (r.robot_status == "ROBOT_CAT_DETECT") s.status_text = "Cat Detected";
-        
-        s.is_error_state = (r.robot_status.indexOf("FAULT") != -1);
-        
-        return s;
+        std::shared_ptr<const Snapshot> snap = snapshot();
+        const WhiskerStatus* r = snap->statuses->newest();
+        if (!r) return SL_Status{ApiType::WHISKER,"", "", 0, 0, 0, false, false, "Unknown"};
+        return _toUnifiedStatus(*r);
+    }
+
+    void setRawRetentionDays(int days) override { _rollups.setRawRetentionDays(days); }
+
+    std::vector<SL_Status> getUnifiedStatuses() const override {
+        std::shared_ptr<const Snapshot> snap = snapshot();
+        std::vector<SL_Status> unified;
+        for (const auto& r : snap->statuses->entries()) {
+            unified.push_back(_toUnifiedStatus(r));
+        }
+        return unified;
     }
 
-    const std::vector<WhiskerStatus>& getStatusRecords() const { return _status_records; }
+    // One entry per robot (a copy; see snapshot())
+    std::vector<WhiskerStatus> getStatusRecords() const { return snapshot()->statuses->entries(); }
     
     WhiskerStatus getLatestStatus() const {
-        if (_status_records.empty()) return WhiskerStatus{};
-        return _status_records.front();
+        std::shared_ptr<const Snapshot> snap = snapshot();
+        const WhiskerStatus* r = snap->statuses->newest();
+        return r ? *r : WhiskerStatus{};
+    }
+
+    WhiskerStatus getLatestStatus(const String& serial) const {
+        std::shared_ptr<const Snapshot> snap = snapshot();
+        const WhiskerStatus* r = snap->statuses->find(serial);
+        return r ? *r : WhiskerStatus{};
     }
 
 private:
     const char* _email;
     const char* _password;
     const char* _timezone;
-    bool _debug;
+    uint8_t _log_level;
 
     String _id_token;
     String _access_token;
     String _user_id;
 
+    RequestScheduler* _scheduler;
+    HttpTransport* _transport;
+    int _retries_left;
+    size_t _max_in_flight;
+
+    // Working state of the running fetch; readers only see _published.
+    // _records starts from the published records' chunks, replaces those the
+    // merge touches and is moved into the next snapshot, so it is empty
+    // between fetches.
     std::vector<WhiskerPet> _pets;
-    std::vector<WhiskerRecord> _records;
-    std::vector<WhiskerStatus> _status_records; 
+    RecordChunks<WhiskerRecord> _records;   // Newest first, deduplicated
+    DeviceStatusTable<WhiskerStatus> _status_table;
+    SnapshotCell<Snapshot> _published;
+    DailyRollupStore _rollups;              // Working copy; readers see the published one
+    ChangeDetector _changes;
 
-    void _log(const String& msg);
+    // Whether _pets / _status_table hold a fetched list, so a record pass
+    // walked every source
+    bool _have_pets;
+    bool _have_robots;
+    // Newest event timestamp held per source (pet uuid or robot serial)
+    std::unordered_map<String, time_t, SL_StringHash> _newest_seen;
+    // Newest event timestamp passed to onRecord() per source; survives a
+    // full refresh, so refetched history is not delivered twice
+    std::unordered_map<String, time_t, SL_StringHash> _delivered;
+    bool _full_refresh;
+    int _max_sync_limit;
+    size_t _max_records;
+
+    void _logf(uint8_t level, const char* fmt, ...) __attribute__((format(printf, 3, 4)));
     bool _parseJwtForUserId(const String& token);
     
-    String _sendRequest(const char* url, const char* method, const String& payload, const char* contentType = "application/json");
-    String _sendGraphQL(const char* url, const String& query, const String& variables = "{}");
+    void _buildRequest(HttpRequest& req, const char* url, const char* method, const String& payload, const char* contentType, uint8_t size_class);
+    // size_class: RequestScheduler::sizeClass of the entries asked for
+    bool _sendRequest(const char* url, const char* method, const String& payload, JsonDocument& out,
+                      uint8_t size_class = 0, const char* contentType = "application/json");
+    bool _sendGraphQL(const char* url, const GraphQLRequest& request, JsonDocument& out);
+    bool _checkResponse(const char* url, const HttpResponse& resp, DeserializationError error);
+
+    // First page of one pet / robot, fetched ahead as part of a batch
+    struct FirstPage {
+        std::vector<WhiskerRecord> page;
+        int returned = -1;
+        bool done = false;      // False: not fetched, use the blocking path
+    };
+    void _prefetchFirstPages(int limit, std::vector<FirstPage>& pages);
+
+    bool _fetchPets();
+    int _fetchPetWeightHistory(const WhiskerPet& pet, int limit, std::vector<WhiskerRecord>& page);
+    int _fetchRobotActivity(const String& serial, int limit, std::vector<WhiskerRecord>& page);
+    static String _weightQuery(const WhiskerPet& pet, int limit);
+    static String _activityQuery(const String& serial, int limit);
+    int _parseWeightHistory(const WhiskerPet& pet, JsonDocument& doc, std::vector<WhiskerRecord>& page);
+    int _parseRobotActivity(const String& serial, JsonDocument& doc, std::vector<WhiskerRecord>& page);
+    bool _fetchRobots();
+    void _detectChanges();
+    bool _syncSource(const String& source, int limit, std::vector<WhiskerRecord>& fresh,
+                     const std::function<int(int, std::vector<WhiskerRecord>&)>& fetch);
+    void _mergeRecords(std::vector<WhiskerRecord>& fresh);
+    void _compactRecords();
+    void _trimRecords();
+    void _publish(bool pets, bool records, bool statuses);
 
-    void _fetchPets();
-    void _fetchPetWeightHistory(const WhiskerPet& pet, int limit);
-    void _fetchRobotsAndCycles(int limit);
+    static const String& _sourceOf(const WhiskerRecord& r) {
+        return r.pet_uuid.length() > 0 ? r.pet_uuid : r.device_serial;
+    }
+    static bool _newerFirst(const WhiskerRecord& a, const WhiskerRecord& b);
+    bool _isHeld(const WhiskerRecord& r) const;
+
+    // False for robot-only events, which are not exposed as unified records
+    static bool _toView(const WhiskerRecord& r, SL_RecordView& out) {
+        if (r.pet_name.length() == 0 && r.event_type != "Pet Weight Recorded") return false;
+        out.pet_name = r.pet_name.length() > 0 ? r.pet_name.c_str() : "Unknown Cat";
+        out.PetId = r.pet_id;
+        out.timestamp = r.timestamp;
+        out.weight_lbs = r.weight_lbs;
+        out.duration_seconds = 0;
+        out.action = r.event_type.c_str();
+        out.source_device = r.device_model.c_str();
+        return true;
+    }
+
+    // Robot-only events too, as the robot's pet-less entry (PetId 0)
+    static void _toEntryView(const WhiskerRecord& r, SL_RecordView& out) {
+        if (_toView(r, out)) return;
+        out.pet_name = "";
+        out.PetId = 0;
+        out.timestamp = r.timestamp;
+        out.weight_lbs = 0;
+        out.duration_seconds = 0;
+        out.action = r.event_type.c_str();
+        out.source_device = r.device_model.c_str();
+    }
+
+    static SL_Status _toUnifiedStatus(const WhiskerStatus& r) {
+        SL_Status s;
+        s.api_type = ApiType::WHISKER;
+        s.device_name = r.device_serial; // Whisker uses Serial as primary ID often
+        s.device_type = r.device_model;
+        s.timestamp = r.timestamp;
+        s.litter_level_percent = r.litter_level_percent;
+        s.waste_level_percent = r.waste_level_percent;
+        s.is_drawer_full = r.is_drawer_full;
+        
+        // Map common Whisker statuses to text
+        switch (r.robot_state) {
+            case WhiskerRobotState::IDLE: s.status_text = "Ready"; break;
+            case WhiskerRobotState::CLEANING: s.status_text = "Cleaning"; break;
+            case WhiskerRobotState::CAT_DETECTED: s.status_text = "Cat Detected"; break;
+            default: s.status_text = r.robot_status; break;
+        }
+        
+        s.is_error_state = (r.robot_state == WhiskerRobotState::FAULT);
+        
+        return s;
+    }
 };
 
 #endif
\ No newline at end of file